@@ -0,0 +1,116 @@
+/*
+** icbench.c
+** Speed and hit rate of the inline caches of GETFIELD, SETFIELD and SELF
+** See Copyright Notice in lua.h
+**
+** Build against the library in ../src (after 'make' there):
+**   cc -O2 -I../src icbench.c ../src/liblua.a -lm -ldl -o icbench
+** Build twice, with and without -DLUAI_NOICACHE in ../src, to compare
+** the loops with and without inline caches. To see hit rates, build
+** both the library and this program with -DLUAI_ICSTATS (the counters
+** slow down every probe, so take times from a build without it).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "lualib.h"
+
+#if defined(LUAI_ICSTATS)
+#include "lstate.h"
+#include "ltable.h"
+#endif
+
+
+#define NITER		2000000	/* iterations per loop */
+#define NROUNDS		5	/* best of NROUNDS */
+
+
+/*
+** Each loop gets 'n' (the number of iterations) as its argument. The
+** code of every loop runs once before it is timed, so that the caches
+** start warm.
+*/
+static const struct {
+  const char *name;
+  const char *code;
+} loops[] = {
+  {"record fields",  /* one layout at every site */
+   "local n = ...\n"
+   "local p = {x = 1, y = 2, z = 3}\n"
+   "for i = 1, n do p.x = p.x + p.y; p.z = p.x - p.z end\n"},
+  {"many records, one layout",  /* tables share their slots */
+   "local n = ...\n"
+   "local ps = {}\n"
+   "for i = 1, 64 do ps[i] = {x = i, y = 2, z = 3} end\n"
+   "for i = 1, n do local p = ps[i % 64 + 1]; p.y = p.x + p.z end\n"},
+  {"method calls",  /* methods miss: SELF finds them through '__index' */
+   "local n = ...\n"
+   "local C = {}; C.__index = C\n"
+   "function C:get () return self.v end\n"
+   "function C:set (v) self.v = v end\n"
+   "local o = setmetatable({v = 0}, C)\n"
+   "for i = 1, n do o:set(o:get() + 1) end\n"},
+  {"two layouts, one site",  /* same keys, different order */
+   "local n = ...\n"
+   "local a = {x = 1, y = 2}\n"
+   "local b = {y = 2, x = 1}\n"
+   "local s = 0\n"
+   "for i = 1, n do local p = (i & 1 == 0) and a or b; s = s + p.x end\n"},
+  {"large hash table",  /* beyond the shape limits */
+   "local n = ...\n"
+   "local t = {}\n"
+   "for i = 1, 100 do t['k' .. i] = i end\n"
+   "local s = 0\n"
+   "for i = 1, n do s = s + t.k1 + t.k50 + t.k100 end\n"},
+};
+
+
+static double now (void) {
+  return (double)clock() / CLOCKS_PER_SEC;
+}
+
+
+static void run (lua_State *L, int i) {
+  double best = 1e9;
+  int r;
+  if (luaL_loadstring(L, loops[i].code) != LUA_OK) {
+    fprintf(stderr, "icbench: %s\n", lua_tostring(L, -1));
+    exit(EXIT_FAILURE);
+  }
+  for (r = 0; r <= NROUNDS; r++) {  /* round 0 only warms the caches */
+    double t;
+#if defined(LUAI_ICSTATS)
+    luaH_icprobes = luaH_icmisses = 0;
+#endif
+    lua_pushvalue(L, -1);
+    lua_pushinteger(L, (r == 0) ? 1 : NITER);
+    t = now();
+    lua_call(L, 1, 0);
+    t = now() - t;
+    if (r > 0 && t < best) best = t;
+  }
+  lua_pop(L, 1);
+#if defined(LUAI_ICSTATS)
+  printf("%-26s %7.1f ns/iter  %5.1f%% hits\n", loops[i].name,
+         best * 1e9 / NITER, (luaH_icprobes == 0) ? 0.0 :
+         100.0 * (double)(luaH_icprobes - luaH_icmisses) / luaH_icprobes);
+#else
+  printf("%-26s %7.1f ns/iter\n", loops[i].name, best * 1e9 / NITER);
+#endif
+}
+
+
+int main (void) {
+  lua_State *L = luaL_newstate();
+  int i;
+  luaL_openlibs(L);
+  for (i = 0; i < (int)(sizeof(loops) / sizeof(loops[0])); i++)
+    run(L, i);
+  lua_close(L);
+  return 0;
+}
+
@@ -0,0 +1,131 @@
+/*
+** strbench.c
+** Interning throughput of 'luaS_hash'
+** See Copyright Notice in lua.h
+**
+** Build against the library in ../src (after 'make' there):
+**   cc -O2 -I../src strbench.c ../src/liblua.a -lm -ldl -o strbench
+** Build twice, with and without -DLUAI_BYTEHASH in ../src, to compare
+** the word-at-a-time hash against the original one.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "lua.h"
+#include "lauxlib.h"
+
+
+#define NSTRS		200000	/* strings per length class */
+#define NROUNDS		5	/* best of NROUNDS */
+
+static char *strs[NSTRS];
+static size_t lens[NSTRS];
+
+
+/* xorshift; fixed seed, so that every build sees the same strings */
+static unsigned long rnd (void) {
+  static unsigned long s = 12345;
+  s ^= (s << 13) & 0xffffffffUL;
+  s ^= s >> 17;
+  s ^= (s << 5) & 0xffffffffUL;
+  return s;
+}
+
+
+static double now (void) {
+  return (double)clock() / CLOCKS_PER_SEC;
+}
+
+
+/* identifier-like strings with lengths in [lo, hi] */
+static void gen (size_t lo, size_t hi) {
+  static const char chars[] = "abcdefghijklmnopqrstuvwxyz_0123456789";
+  int i;
+  for (i = 0; i < NSTRS; i++) {
+    size_t j, l = lo + rnd() % (hi - lo + 1);
+    char *s = (char *)malloc(l);
+    if (s == NULL) { perror("strbench"); exit(EXIT_FAILURE); }
+    for (j = 0; j < l; j++)
+      s[j] = chars[rnd() % (sizeof(chars) - 1)];
+    strs[i] = s;
+    lens[i] = l;
+  }
+}
+
+
+static void freestrs (void) {
+  int i;
+  for (i = 0; i < NSTRS; i++)
+    free(strs[i]);
+}
+
+
+/*
+** Short strings: push every string through 'lua_pushlstring'. The first
+** round creates them; the others (kept alive in a table) find them in
+** the string table, so the best round measures hashing plus lookup.
+*/
+static void shortstrs (const char *name, size_t lo, size_t hi) {
+  lua_State *L = luaL_newstate();
+  double best = 1e9;
+  int r, i;
+  gen(lo, hi);
+  lua_createtable(L, NSTRS, 0);
+  for (r = 0; r < NROUNDS; r++) {
+    double t = now();
+    for (i = 0; i < NSTRS; i++) {
+      lua_pushlstring(L, strs[i], lens[i]);
+      lua_rawseti(L, 1, i + 1);
+    }
+    t = now() - t;
+    if (t < best) best = t;
+  }
+  printf("%-26s %7.1f ns/string\n", name, best * 1e9 / NSTRS);
+  lua_close(L);
+  freestrs();
+}
+
+
+/*
+** Long strings are not interned; they are hashed when used as keys.
+** Look up every key with a fresh string object, so that each lookup
+** hashes the whole string once.
+*/
+static void longkeys (const char *name, size_t lo, size_t hi) {
+  lua_State *L = luaL_newstate();
+  double best = 1e9;
+  int r, i;
+  gen(lo, hi);
+  lua_createtable(L, 0, NSTRS);
+  for (i = 0; i < NSTRS; i++) {
+    lua_pushlstring(L, strs[i], lens[i]);
+    lua_pushboolean(L, 1);
+    lua_rawset(L, 1);
+  }
+  for (r = 0; r < NROUNDS; r++) {
+    double t = now();
+    for (i = 0; i < NSTRS; i++) {
+      lua_pushlstring(L, strs[i], lens[i]);
+      lua_rawget(L, 1);
+      lua_pop(L, 1);
+    }
+    t = now() - t;
+    if (t < best) best = t;
+  }
+  printf("%-26s %7.1f ns/lookup\n", name, best * 1e9 / NSTRS);
+  lua_close(L);
+  freestrs();
+}
+
+
+int main (void) {
+  shortstrs("identifiers, 3-12 bytes", 3, 12);
+  shortstrs("field keys, 12-32 bytes", 12, 32);
+  shortstrs("short strings, 33-40 bytes", 33, 40);
+  longkeys("long keys, 64-256 bytes", 64, 256);
+  longkeys("long keys, 1K-4K bytes", 1024, 4096);
+  return 0;
+}
+
@@ -206,6 +206,25 @@ LUA_API lua_CFunction lua_atpanic (lua_State *L, lua_CFunction panicf) {
   return old;
 }
 
+/*
+** Declare 'nextf' as the primitive 'next' (a function behaving exactly
+** as 'next' of the base library), so that generic 'for' loops using it
+** as their iterator can traverse tables in place (see lua.h).
+*/
+
+/// @brief 设置原始next函数,通用for循环用它遍历表时VM直接在表上遍历
+/// @param L 
+/// @param nextf 
+/// @return 之前设置的函数
+lua_CFunction luaA_setnextf (lua_State *L, lua_CFunction nextf) {
+  lua_CFunction old;
+  lua_lock(L);
+  old = G(L)->nextf;
+  G(L)->nextf = nextf;
+  lua_unlock(L);
+  return old;
+}
+
 /// @brief 获取lua版本
 /// @param L 
 /// @return 
@@ -592,6 +611,14 @@ LUA_API const char *lua_tolstring (lua_State *L, int idx, size_t *len) {
     luaC_checkGC(L);
     o = index2value(L, idx);  /* previous call may reallocate the stack */
   }
+  else {
+    TString *ts = luaS_seal(L, tsvalue(o));
+    if (ts != tsvalue(o)) {  /* got a zero-terminated copy? */
+      setsvalue(L, o, ts);  /* use it instead */
+      luaC_checkGC(L);
+      o = index2value(L, idx);  /* previous call may reallocate the stack */
+    }
+  }
   if (len != NULL)
     *len = vslen(o);
   lua_unlock(L);
@@ -600,7 +627,7 @@ LUA_API const char *lua_tolstring (lua_State *L, int idx, size_t *len) {
 
 /// @brief 返回给定索引处值的原始“长度”：对于字符串，这是字符串长度；
 /// 对于字符串，这是字符串长度。对于表，这是没有元方法的长度运算符（' # '）的结果；
-/// 对于用户数据，这是为用户数据分配的内存块的大小。
+/// 对于用户数据，这是为用户数据分配的内存块的大小；对于类型化数组，这是元素个数。
 /// 对于其他值，此调用返回0。
 /// @param L 
 /// @param idx 
@@ -610,7 +637,10 @@ LUA_API lua_Unsigned lua_rawlen (lua_State *L, int idx) {
   switch (ttypetag(o)) {
     case LUA_VSHRSTR: return tsvalue(o)->shrlen;
     case LUA_VLNGSTR: return tsvalue(o)->u.lnglen;
-    case LUA_VUSERDATA: return uvalue(o)->len;
+    case LUA_VUSERDATA: {
+      Udata *u = uvalue(o);
+      return (u->atype != 0) ? luaV_arraylen(u) : u->len;
+    }
     case LUA_VTABLE: return luaH_getn(hvalue(o));
     default: return 0;
   }
@@ -650,6 +680,23 @@ LUA_API void *lua_touserdata (lua_State *L, int idx) {
   return touserdata(o);
 }
 
+/// @brief 如果给定索引处的值是类型化数组,返回其元素内存块的地址,并通过atype和n返回元素类型和元素个数;否则返回NULL
+/// @param L 
+/// @param idx 
+/// @param atype 可以为NULL
+/// @param n 可以为NULL
+/// @return 
+LUA_API void *lua_toarray (lua_State *L, int idx, int *atype, size_t *n) {
+  const TValue *o = index2value(L, idx);
+  Udata *u;
+  if (!ttisarray(o))
+    return NULL;
+  u = uvalue(o);
+  if (atype != NULL) *atype = u->atype;
+  if (n != NULL) *n = luaV_arraylen(u);
+  return getudatamem(u);
+}
+
 /// @brief 将给定索引处的值转换为Lua线程（表示为 lua_State* ）。该值必须是线程；否则，该函数返回 NULL 。
 /// @param L 
 /// @param idx 
@@ -752,6 +799,50 @@ LUA_API const char *lua_pushlstring (lua_State *L, const char *s, size_t len) {
   return getstr(ts);
 }
 
+/// @brief 把给定索引处字符串中从偏移'i'开始的'len'个字节作为子串压栈。
+/// 足够长的子串直接引用原字符串的内容而不进行拷贝(见'luaS_newsub')
+/// @param L 
+/// @param idx 
+/// @param i 
+/// @param len 
+LUA_API void lua_pushsubstring (lua_State *L, int idx, size_t i, size_t len) {
+  const TValue *o;
+  TString *ts;
+  lua_lock(L);
+  o = index2value(L, idx);
+  api_check(L, ttisstring(o), "string expected");
+  api_check(L, i <= vslen(o) && len <= vslen(o) - i, "invalid substring");
+  ts = luaS_newsub(L, tsvalue(o), i, len);
+  setsvalue2s(L, L->top, ts);
+  api_incr_top(L);
+  luaC_checkGC(L);
+  lua_unlock(L);
+}
+
+/// @brief 把外部内存's'中的'len'个字节作为字符串压栈,不进行拷贝(s[len]必须是'\0')。
+/// 字符串被回收时调用'falloc(ud, s, len + 1, 0)'释放这块内存('falloc'可以为NULL)。
+/// 短字符串需要内部化,所以会拷贝一份并立即释放's'。
+/// 调用后's'总是归Lua所有:即使创建字符串时出错(如内存不足),也会先释放's'再抛出错误
+/// @param L 
+/// @param s 
+/// @param len 
+/// @param falloc 
+/// @param ud 
+/// @return 
+LUA_API const char *lua_pushexternalstring (lua_State *L, const char *s,
+                                   size_t len, lua_Alloc falloc, void *ud) {
+  TString *ts;
+  lua_lock(L);
+  api_check(L, len < MAX_SIZE - sizeextstr, "string too large");
+  api_check(L, s[len] == '\0', "string not ending with zero");
+  ts = luaS_newextlstr(L, s, len, falloc, ud);
+  setsvalue2s(L, L->top, ts);
+  api_incr_top(L);
+  luaC_checkGC(L);
+  lua_unlock(L);
+  return getstr(ts);
+}
+
 /// @brief 将 s 所指向的零终止字符串推入堆栈。Lua将创建或重用给定字符串的内部副本，因此可以在函数返回后立即释放或重用 s 处的内存。
 /// 如果 s 为 NULL ，则推送nil并返回 NULL 。
 /// @param L 
@@ -1335,6 +1426,7 @@ LUA_API int lua_setmetatable (lua_State *L, int objindex) {
   }
   switch (ttype(obj)) {
     case LUA_TTABLE: {
+      luaH_checkwrite(L, hvalue(obj));
       hvalue(obj)->metatable = mt;
       if (mt) {
         luaC_objbarrier(L, gcvalue(obj), mt);
@@ -1610,6 +1702,7 @@ LUA_API int lua_status (lua_State *L) {
 // LUA_GCISRUNNING ：返回一个布尔值，该布尔值指示收集器是否正在运行（即未停止）。
 // LUA_GCINC (int pause, int stepmul, stepsize)：使用给定参数将收集器更改为增量模式。返回之前的模式（ LUA_GCGEN 或 LUA_GCINC ）。
 // LUA_GCGEN (int minormul, int majormul)：使用给定参数将收集器更改为分代模式。返回之前的模式（ LUA_GCGEN 或 LUA_GCINC ）。
+// LUA_GCSHRINK (int on)：打开(非0)或关闭GC对表数组部分末尾空槽位的自动释放。返回之前的设置。
 /// @param L 
 /// @param what 
 /// @param  
@@ -1705,6 +1798,12 @@ LUA_API int lua_gc (lua_State *L, int what, ...) {
       luaC_changemode(L, KGC_INC);
       break;
     }
+    case LUA_GCSHRINK: {
+      int on = va_arg(argp, int);
+      res = g->gcshrink;
+      g->gcshrink = (on != 0);
+      break;
+    }
     default: res = -1;  /* invalid option */
   }
   va_end(argp);
@@ -1772,6 +1871,110 @@ LUA_API int lua_next (lua_State *L, int idx) {
   return more;
 }
 
+
+/*
+** Resize the table at index 'idx' to the sizes a rehash would give it,
+** if that frees memory. Like adding a key, this must not be done while
+** traversing the table. Returns 1 if the table was resized.
+*/
+
+/// @brief 把idx处的表压缩到rehash会给出的大小(只在能释放内存时调整),返回是否调整了大小
+/// @param L 
+/// @param idx 
+/// @return 
+LUA_API int lua_compacttable (lua_State *L, int idx) {
+  Table *t;
+  int res;
+  lua_lock(L);
+  t = gettable(L, idx);
+  res = luaH_compact(L, t);
+  luaC_checkGC(L);
+  lua_unlock(L);
+  return res;
+}
+
+
+/*
+** Freeze the table at index 'idx': from now on, any change to its keys,
+** values, or metatable raises an error. Its parts are rebuilt for fast
+** searches first, so this must not be done while traversing it.
+*/
+
+/// @brief 冻结idx处的表,之后对它的键、值或元表的任何修改都会报错
+/// @param L 
+/// @param idx 
+LUA_API void lua_freeze (lua_State *L, int idx) {
+  Table *t;
+  lua_lock(L);
+  t = gettable(L, idx);
+  luaH_freeze(L, t);
+  luaC_checkGC(L);
+  lua_unlock(L);
+}
+
+
+/// @brief idx处的表是否被冻结
+/// @param L 
+/// @param idx 
+/// @return 
+LUA_API int lua_isfrozen (lua_State *L, int idx) {
+  Table *t;
+  int res;
+  lua_lock(L);
+  t = gettable(L, idx);
+  res = isfrozen(t);
+  lua_unlock(L);
+  return res;
+}
+
+
+/// @brief 清空idx处的表,但保留它已分配的数组部分和hash部分,以便重新填充时不用再扩容
+/// @param L 
+/// @param idx 
+LUA_API void lua_cleartable (lua_State *L, int idx) {
+  Table *t;
+  lua_lock(L);
+  t = gettable(L, idx);
+  luaH_clear(L, t);
+  lua_unlock(L);
+}
+
+
+/* true if indexing table 't' never calls a metamethod */
+#define plaintable(L,t)  ((t)->metatable == NULL || \
+  (fasttm(L, (t)->metatable, TM_INDEX) == NULL && \
+   fasttm(L, (t)->metatable, TM_NEWINDEX) == NULL))
+
+
+/*
+** Move the elements a1[f..e] to a2[t..] (as 'table.move' does) with one
+** block copy, if the values at 'idx1' and 'idx2' are tables without
+** '__index' and '__newindex' metamethods and both ranges lie inside
+** their array parts. Otherwise, does nothing and returns 0.
+*/
+
+/// @brief 两个表都没有__index/__newindex并且范围都在数组部分时,用一次内存移动完成a1[f..e]到a2[t..]的移动,否则返回0
+/// @param L 
+/// @param idx1 
+/// @param f 
+/// @param e 
+/// @param t 
+/// @param idx2 
+/// @return 
+LUA_API int lua_arraymove (lua_State *L, int idx1, lua_Integer f,
+                           lua_Integer e, lua_Integer t, int idx2) {
+  const TValue *a1, *a2;
+  int res = 0;
+  lua_lock(L);
+  a1 = index2value(L, idx1);
+  a2 = index2value(L, idx2);
+  if (ttistable(a1) && ttistable(a2) &&
+      plaintable(L, hvalue(a1)) && plaintable(L, hvalue(a2)))
+    res = luaH_movearray(L, hvalue(a1), f, e, hvalue(a2), t);
+  lua_unlock(L);
+  return res;
+}
+
 /// @brief 将堆栈中的给定索引标记为要关闭的变量
 /// @param L 
 /// @param idx 
@@ -1807,6 +2010,63 @@ LUA_API void lua_concat (lua_State *L, int n) {
   lua_unlock(L);
 }
 
+
+/*
+** Push the concatenation of t[i..j] of the table at 'idx' (as
+** 'table.concat' does), if all these elements are strings or numbers in
+** the array part. Otherwise, does nothing and returns 0.
+** (A hook for 'table.concat', not part of the API; see lua.h.)
+*/
+
+/// @brief 把idx处的表的t[i]..sep..t[j]连接后的结果放到栈顶并返回1;表中这些元素不都是数组部分中的字符串或数字时什么也不做,返回0
+/// @param L 
+/// @param idx 
+/// @param i 
+/// @param j 
+/// @param sep 
+/// @param lsep 
+/// @return 
+int luaA_concattable (lua_State *L, int idx, lua_Integer i,
+                      lua_Integer j, const char *sep, size_t lsep) {
+  const TValue *t;
+  TString *ts = NULL;
+  lua_lock(L);
+  t = index2value(L, idx);
+  if (ttistable(t))
+    ts = luaV_concattable(L, hvalue(t), i, j, sep, lsep);
+  if (ts != NULL) {
+    setsvalue2s(L, L->top, ts);
+    api_incr_top(L);
+    luaC_checkGC(L);
+  }
+  lua_unlock(L);
+  return (ts != NULL);
+}
+
+/*
+** Sort t[1..n] (as 'table.sort' without an order function does) directly
+** on the array part of the table at 'idx', if all these elements are
+** strings or all are numbers. Otherwise, does nothing and returns 0.
+** (A hook for 'table.sort', not part of the API; see lua.h.)
+*/
+
+/// @brief idx处的表的t[1..n]都在数组部分并且全是字符串或全是数字时直接排序,否则返回0
+/// @param L 
+/// @param idx 
+/// @param n 
+/// @param stable 是否保持相等元素的顺序
+/// @return 
+int luaA_sortarray (lua_State *L, int idx, lua_Integer n, int stable) {
+  const TValue *t;
+  int res = 0;
+  lua_lock(L);
+  t = index2value(L, idx);
+  if (ttistable(t))
+    res = luaV_sortarray(L, hvalue(t), n, stable);
+  lua_unlock(L);
+  return res;
+}
+
 /// @brief 获取index处元素#操作符的结果 , 放置在栈顶.
 /// @param L 
 /// @param idx 
@@ -1887,6 +2147,30 @@ LUA_API void *lua_newuserdatauv (lua_State *L, size_t size, int nuvalue) {
 }
 
 
+/// @brief 创建一个有n个元素(初始为0)的类型化数组并压栈,返回元素内存块的地址
+/// @param L 
+/// @param atype 元素类型 LUA_AINT8 ... LUA_AFLOAT64
+/// @param n 元素个数
+/// @return 
+LUA_API void *lua_newarray (lua_State *L, int atype, size_t n) {
+  Udata *u;
+  int ls;
+  lua_lock(L);
+  api_check(L, 0 < atype && atype <= LUA_NUMATYPES, "invalid array type");
+  ls = luaV_arraylsize[atype];
+  if (l_unlikely(n > (MAX_SIZE >> ls)))
+    luaM_toobig(L);
+  u = luaS_newudata(L, n << ls, 0);
+  u->atype = cast_byte(atype);
+  memset(getudatamem(u), 0, n << ls);
+  setuvalue(L, s2v(L->top), u);
+  api_incr_top(L);
+  luaC_checkGC(L);
+  lua_unlock(L);
+  return getudatamem(u);
+}
+
+
 /// @brief 
 /// @param fi 指定索引的值
 /// @param n 第几个upvalue
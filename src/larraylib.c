@@ -0,0 +1,83 @@
+/*
+ * @文件作用: lua 类型化数组库
+ * @功能分类: 周边
+ */
+/*
+** $Id: larraylib.c $
+** Standard library for typed numeric arrays
+** See Copyright Notice in lua.h
+*/
+
+#define larraylib_c
+#define LUA_LIB
+
+#include "lprefix.h"
+
+
+#include "lua.h"
+
+#include "lauxlib.h"
+#include "lualib.h"
+
+
+/* names of the element types, in the order of LUA_AINT8 ... */
+static const char *const atypenames[] = {
+  "int8", "int16", "int32", "int64", "float32", "float64", NULL
+};
+
+
+/*
+** array.new(type, n) creates a typed array with 'n' zeros;
+** array.new(type, t) creates one with the elements of sequence 't'.
+*/
+
+/// @brief 创建类型化数组,第二个参数为元素个数或者用来初始化的序列
+/// @param L
+/// @return
+static int array_new (lua_State *L) {
+  int atype = luaL_checkoption(L, 1, NULL, atypenames) + 1;
+  if (lua_type(L, 2) == LUA_TTABLE) {
+    lua_Integer n = luaL_len(L, 2);
+    lua_Integer i;
+    luaL_argcheck(L, n >= 0, 2, "invalid length");
+    lua_newarray(L, atype, (size_t)n);
+    for (i = 1; i <= n; i++) {
+      lua_geti(L, 2, i);
+      lua_seti(L, -2, i);  /* raises an error for non-numbers */
+    }
+  }
+  else {
+    lua_Integer n = luaL_checkinteger(L, 2);
+    luaL_argcheck(L, n >= 0, 2, "invalid size");
+    lua_newarray(L, atype, (size_t)n);
+  }
+  return 1;
+}
+
+
+/// @brief 返回类型化数组的元素类型名,不是类型化数组时返回fail
+/// @param L
+/// @return
+static int array_type (lua_State *L) {
+  int atype;
+  luaL_checkany(L, 1);
+  if (lua_toarray(L, 1, &atype, NULL) == NULL)
+    luaL_pushfail(L);
+  else
+    lua_pushstring(L, atypenames[atype - 1]);
+  return 1;
+}
+
+
+static const luaL_Reg array_funcs[] = {
+  {"new", array_new},
+  {"type", array_type},
+  {NULL, NULL}
+};
+
+
+LUAMOD_API int luaopen_array (lua_State *L) {
+  luaL_newlib(L, array_funcs);
+  return 1;
+}
+
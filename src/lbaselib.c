@@ -217,12 +217,14 @@ static int luaB_rawequal (lua_State *L) {
 // 对于字符串，它指字符串的长度； 
 // 对于表；它指不触发元方法的情况下取长度操作（'#'）应得到的值； 
 // 对于用户数据，它指为该用户数据分配的内存块的大小； 对于其它值，它为 0 
+// rawlen接受表、字符串和类型化数组(返回元素个数)
 /// @param L 
 /// @return 
 static int luaB_rawlen (lua_State *L) {
   int t = lua_type(L, 1);
-  luaL_argexpected(L, t == LUA_TTABLE || t == LUA_TSTRING, 1,
-                      "table or string");
+  luaL_argexpected(L, t == LUA_TTABLE || t == LUA_TSTRING ||
+                      lua_toarray(L, 1, NULL, NULL) != NULL, 1,
+                      "table, string or typed array");
   lua_pushinteger(L, lua_rawlen(L, 1));
   return 1;
 }
@@ -292,6 +294,7 @@ static int pushmode (lua_State *L, int oldmode) {
 // "setpause": 将 arg 设为收集器的 间歇率 。 返回 间歇率 的前一个值。
 // "setstepmul": 将 arg 设为收集器的 步进倍率 。 返回 步进倍率 的前一个值。
 // "isrunning": 返回表示收集器是否在工作的布尔值 （即未被停止）。
+// "shrink": arg 为真时让收集器释放表数组部分末尾过多的空槽位(见 LUAI_SHRINKRATIO)，为假时关闭。 返回之前的设置。
 // 在lua.h中有如下定义：
 // #define LUA_GCSTOP              0
 // #define LUA_GCRESTART           1
@@ -304,6 +307,7 @@ static int pushmode (lua_State *L, int oldmode) {
 // #define LUA_GCISRUNNING         9
 // #define LUA_GCGEN		           10
 // #define LUA_GCINC		           11
+// #define LUA_GCSHRINK		       12
 // luaL_checkoption：检查函数的第 arg 个参数是否是一个 字符串，并在数组 lst （比如是零结尾的字符串数组） 中查找这个字符串。 返回匹配到的字符串在数组中的索引号。 
 //                   如果参数不是字符串，或是字符串在数组中匹配不到，都将抛出错误。
 // 所以这里o保存了optsnum的元素，然后通过switch
@@ -315,10 +319,10 @@ static int pushmode (lua_State *L, int oldmode) {
 static int luaB_collectgarbage (lua_State *L) {
   static const char *const opts[] = {"stop", "restart", "collect",
     "count", "step", "setpause", "setstepmul",
-    "isrunning", "generational", "incremental", NULL};
+    "isrunning", "generational", "incremental", "shrink", NULL};
   static const int optsnum[] = {LUA_GCSTOP, LUA_GCRESTART, LUA_GCCOLLECT,
     LUA_GCCOUNT, LUA_GCSTEP, LUA_GCSETPAUSE, LUA_GCSETSTEPMUL,
-    LUA_GCISRUNNING, LUA_GCGEN, LUA_GCINC};
+    LUA_GCISRUNNING, LUA_GCGEN, LUA_GCINC, LUA_GCSHRINK};
   int o = optsnum[luaL_checkoption(L, 1, "collect", opts)];
   switch (o) {
     case LUA_GCCOUNT: {
@@ -349,6 +353,12 @@ static int luaB_collectgarbage (lua_State *L) {
       lua_pushboolean(L, res);
       return 1;
     }
+    case LUA_GCSHRINK: {
+      int res = lua_gc(L, o, lua_toboolean(L, 2));
+      checkvalres(res);
+      lua_pushboolean(L, res);
+      return 1;
+    }
     case LUA_GCGEN: {
       int minormul = (int)luaL_optinteger(L, 2, 0);
       int majormul = (int)luaL_optinteger(L, 3, 0);
@@ -765,6 +775,7 @@ static const luaL_Reg base_funcs[] = {
 /// @param L 
 /// @return 
 LUAMOD_API int luaopen_base (lua_State *L) {
+  luaA_setnextf(L, luaB_next);  /* let 'for' loops traverse tables in place */
   /* open lib into global table */
   lua_pushglobaltable(L);
   luaL_setfuncs(L, base_funcs, 0);
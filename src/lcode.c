@@ -2336,6 +2336,42 @@ static int finaltarget (Instruction *code, int i) {
 }
 
 
+/*
+** Superinstruction for the pair of instructions 'i' and its next one,
+** or the opcode of 'i' itself when the pair has none. The pairs are
+** the most frequent ones reported by 'luac -P' over real code, not
+** counting pairs that already run as one instruction (such as
+** arithmetic and OP_MMBIN, or tests and OP_JMP).
+*/
+
+/// @brief 返回指令i和下一条指令合并后的超级指令
+/// @param i 
+/// @param next 
+/// @return 
+static OpCode superop (Instruction i, Instruction next) {
+  OpCode op = GET_OPCODE(i);
+  switch (op) {
+    case OP_GETTABUP:
+      return (GET_OPCODE(next) == OP_GETFIELD) ? OP_GETTABUPFIELD : op;
+    case OP_GETFIELD: {
+      switch (GET_OPCODE(next)) {
+        case OP_GETFIELD: return OP_GETFIELDFIELD;
+        case OP_CALL: return OP_GETFIELDCALL;
+        default: return op;
+      }
+    }
+    case OP_MOVE: {
+      switch (GET_OPCODE(next)) {
+        case OP_MOVE: return OP_MOVEMOVE;
+        case OP_CALL: return OP_MOVECALL;
+        default: return op;
+      }
+    }
+    default: return op;
+  }
+}
+
+
 /*
 ** Do a final pass over the code of a function, doing small peephole
 ** optimizations and adjustments.
@@ -2371,4 +2407,6 @@ void luaK_finish (FuncState *fs) {
       default: break;
     }
   }
+  for (i = 0; i < fs->pc - 1; i++)  /* mark superinstructions */
+    SET_OPCODE(p->code[i], superop(p->code[i], p->code[i + 1]));
 }
@@ -21,6 +21,7 @@
 #include "lua.h"
 
 #include "lobject.h"
+#include "lopcodes.h"
 #include "lstate.h"
 #include "lundump.h"
 
@@ -103,9 +104,28 @@ static void dumpString (DumpState *D, const TString *s) {
 }
 
 
+/*
+** Dump the code of a function. Instructions rewritten by the
+** interpreter into internal opcodes are saved with their original
+** opcodes.
+*/
 static void dumpCode (DumpState *D, const Proto *f) {
+  int pc;
   dumpInt(D, f->sizecode);
-  dumpVector(D, f->code, f->sizecode);
+  for (pc = 0; pc < f->sizecode; pc++) {
+    if (GET_OPCODE(f->code[pc]) >= NUM_BASEOPCODES)
+      break;  /* found an internal opcode */
+  }
+  if (pc == f->sizecode)  /* only original opcodes? */
+    dumpVector(D, f->code, f->sizecode);
+  else {
+    dumpVector(D, f->code, pc);
+    for (; pc < f->sizecode; pc++) {
+      Instruction i = f->code[pc];
+      SET_OPCODE(i, GET_BASEOPCODE(i));
+      dumpVar(D, i);
+    }
+  }
 }
 
 
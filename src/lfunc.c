@@ -330,6 +330,10 @@ Proto *luaF_newproto (lua_State *L) {
   f->sizelineinfo = 0;
   f->abslineinfo = NULL;
   f->sizeabslineinfo = 0;
+  f->icache = NULL;
+  f->sizeicache = 0;
+  f->templates = NULL;
+  f->sizetemplates = 0;
   f->upvalues = NULL;
   f->sizeupvalues = 0;
   f->numparams = 0;
@@ -347,6 +351,7 @@ Proto *luaF_newproto (lua_State *L) {
 /// @param L 
 /// @param f 
 void luaF_freeproto (lua_State *L, Proto *f) {
+  int i;
   luaM_freearray(L, f->code, f->sizecode);
   luaM_freearray(L, f->p, f->sizep);
   luaM_freearray(L, f->k, f->sizek);
@@ -354,10 +359,35 @@ void luaF_freeproto (lua_State *L, Proto *f) {
   luaM_freearray(L, f->abslineinfo, f->sizeabslineinfo);
   luaM_freearray(L, f->locvars, f->sizelocvars);
   luaM_freearray(L, f->upvalues, f->sizeupvalues);
+  luaM_freearray(L, f->icache, f->sizeicache);
+  for (i = 0; i < f->sizetemplates; i++)
+    luaM_freearray(L, f->templates[i].values, f->templates[i].nfields);
+  luaM_freearray(L, f->templates, f->sizetemplates);
   luaM_free(L, f);
 }
 
 
+/*
+** Create the inline caches of a prototype, one entry per instruction.
+** Entries start at node 0; a wrong guess only costs a normal lookup.
+** The entry of an OP_NEWTEMPLATE holds the index of its template.
+*/
+
+/// @brief 为函数原型创建内联缓存,每条指令一项
+/// @param L 
+/// @param f 
+void luaF_initcache (lua_State *L, Proto *f) {
+  int i;
+  lua_assert(f->icache == NULL);
+  f->icache = luaM_newvector(L, f->sizecode, unsigned int);
+  f->sizeicache = f->sizecode;
+  for (i = 0; i < f->sizecode; i++)
+    f->icache[i] = 0;
+  for (i = 0; i < f->sizetemplates; i++)
+    f->icache[f->templates[i].pc] = i;
+}
+
+
 /*
 ** Look for n-th local variable at line 'line' in function 'func'.
 ** Returns NULL if not found.
@@ -352,11 +352,17 @@ GCObject *luaC_newobj (lua_State *L, int tt, size_t sz) {
 /// @param o 
 static void reallymarkobject (global_State *g, GCObject *o) {
   switch (o->tt) {
-    case LUA_VSHRSTR://短串
-    case LUA_VLNGSTR: {//长串
+    case LUA_VSHRSTR: {//短串
       set2black(o);  /* nothing to visit *///直接涂黑
       break;
     }
+    case LUA_VLNGSTR: {//长串
+      TString *ts = gco2ts(o);
+      set2black(o);//直接涂黑
+      if (ts->shrlen != LSTRREG && ts->owner != ts)  /* content elsewhere? */
+        markobject(g, ts->owner);  /* keep it alive *///标记内容所在的字符串
+      break;
+    }
     case LUA_VUPVAL: {//上值
       UpVal *uv = gco2upv(o);//GCObject转换成上值
       if (upisopen(uv))//上值是不是open的
@@ -397,6 +403,33 @@ static void markmt (global_State *g) {
 }
 
 
+/*
+** mark the keys of the table shapes in list 'p' (each shape adds one
+** key to its parent, so marking that key in every shape marks all of
+** them). If 'sweep', shapes not marked in this cycle are not in use
+** (and neither are their subtrees, as marks go up to the root): they
+** go to list 'deadshapes' with unmarked keys, out of reach of new
+** tables, and are freed after the sweep (see 'sweepshapes').
+*/
+
+//标记链表p中表shape的键;sweep为真时把本轮未被标记的shape摘到deadshapes中
+static void markshapes (global_State *g, Shape **p, int sweep) {
+  Shape *s;
+  while ((s = *p) != NULL) {
+    if (sweep && !s->marked) {  /* not in use? */
+      *p = s->sibling;  /* remove it (and its subtree) from the tree */
+      s->sibling = g->deadshapes;
+      g->deadshapes = s;
+    }
+    else {
+      markobject(g, s->keys[s->nkeys - 1]);
+      markshapes(g, &s->child, sweep);
+      p = &s->sibling;
+    }
+  }
+}
+
+
 /*
 ** mark all objects in list of being-finalized
 */
@@ -472,6 +505,8 @@ static void cleargraylists (global_State *g) {
 /// @param g 
 static void restartcollection (global_State *g) {
   cleargraylists(g);//清除灰色链表
+  g->nshrink = 0;  /* tables queued in an interrupted cycle may be dead */
+  luaH_unmarkshapes(g);  /* marks of the last cycle are stale */
   markobject(g, g->mainthread);//标记主执行栈
   markvalue(g, &g->l_registry);//标记全局注册表
   markmt(g);//标记全局元表
@@ -532,18 +567,28 @@ static void genlink (global_State *g, GCObject *o) {
 /// @param g 
 /// @param h 
 static void traverseweakvalue (global_State *g, Table *h) {
-  Node *n, *limit = gnodelast(h);//得到最后一个元素
+  Table *p;
   /* if there is array part, assume it may have white values (it is not
      worth traversing it now just to check) */
   int hasclears = (h->alimit > 0);//是不是有元素
-  for (n = gnode(h, 0); n < limit; n++) {  /* traverse hash part *///遍历hash元素
-    if (isempty(gval(n)))  /* entry is nil? *///如果是nil值
-      clearkey(n);  /* clear its key *///移除它
-    else {
-      lua_assert(!keyisnil(n));//key类型不能为空
-      markkey(g, n);//标记
-      if (!hasclears && iscleared(g, gcvalueN(gval(n))))  /* a white value? *///如果数组部分没有值,但是hash表中有白色的值
-        hasclears = 1;  /* table will have to be cleared *///说明要清除
+  if (h->shape != NULL) {  /* traverse fields (keys are marked apart) */
+    int i;
+    for (i = 0; !hasclears && i < h->shape->nkeys; i++) {
+      if (iscleared(g, gcvalueN(&h->fields[i])))  /* a white value? */
+        hasclears = 1;  /* table will have to be cleared */
+    }
+  }
+  for (p = h; p != NULL; p = oldhashpart(p)) {  /* each hash part */
+    Node *n, *limit = gnodelast(p);//得到最后一个元素
+    for (n = gnode(p, 0); n < limit; n++) {  /* traverse hash part *///遍历hash元素
+      if (isempty(gval(n)))  /* entry is nil? *///如果是nil值
+        clearkey(n);  /* clear its key *///移除它
+      else {
+        lua_assert(!keyisnil(n));//key类型不能为空
+        markkey(g, n);//标记
+        if (!hasclears && iscleared(g, gcvalueN(gval(n))))  /* a white value? *///如果数组部分没有值,但是hash表中有白色的值
+          hasclears = 1;  /* table will have to be cleared *///说明要清除
+      }
     }
   }
   if (g->gcstate == GCSatomic && hasclears)//如果是GCSatomic阶段并且有元素需要清除
@@ -586,7 +631,7 @@ static int traverseephemeron (global_State *g, Table *h, int inv) {
   int hasww = 0;  /* true if table has entry "white-key -> white-value" *///如果table中有 白色的key->白色的value 那么就为true
   unsigned int i;
   unsigned int asize = luaH_realasize(h);//得到数组的真实长度
-  unsigned int nsize = sizenode(h);//得到hash表的真实长度
+  Table *p;
   /* traverse array part */
   for (i = 0; i < asize; i++) {//遍历数组
     if (valiswhite(&h->array[i])) {//回收对象是白色
@@ -594,20 +639,32 @@ static int traverseephemeron (global_State *g, Table *h, int inv) {
       reallymarkobject(g, gcvalue(&h->array[i]));//标记
     }
   }
-  /* traverse hash part; if 'inv', traverse descending
-     (see 'convergeephemerons') */
-  for (i = 0; i < nsize; i++) {//遍历hash
-    Node *n = inv ? gnode(h, nsize - 1 - i) : gnode(h, i);//通过是倒序还是正序决定取最后一个还是第一个node
-    if (isempty(gval(n)))  /* entry is nil? *///是nil类型
-      clearkey(n);  /* clear its key *///清除它
-    else if (iscleared(g, gckeyN(n))) {  /* key is not marked (yet)? *///能否移除
-      hasclears = 1;  /* table must be cleared *///hasclears设置位true
-      if (valiswhite(gval(n)))  /* value not marked yet? *///回收对象是白色
-        hasww = 1;  /* white-white entry *///hasww设置位true
+  /* fields of a shape have string keys, which are never cleared */
+  if (h->shape != NULL) {
+    for (i = 0; i < cast_uint(h->shape->nkeys); i++) {
+      if (valiswhite(&h->fields[i])) {
+        marked = 1;
+        reallymarkobject(g, gcvalue(&h->fields[i]));
+      }
     }
-    else if (valiswhite(gval(n))) {  /* value not marked yet? *///回收对象是白色
-      marked = 1; //marked设置为1
-      reallymarkobject(g, gcvalue(gval(n)));  /* mark it now *///标记value
+  }
+  /* traverse hash parts; if 'inv', traverse descending
+     (see 'convergeephemerons') */
+  for (p = h; p != NULL; p = oldhashpart(p)) {
+    unsigned int nsize = sizenode(p);//得到hash表的真实长度
+    for (i = 0; i < nsize; i++) {//遍历hash
+      Node *n = inv ? gnode(p, nsize - 1 - i) : gnode(p, i);//通过是倒序还是正序决定取最后一个还是第一个node
+      if (isempty(gval(n)))  /* entry is nil? *///是nil类型
+        clearkey(n);  /* clear its key *///清除它
+      else if (iscleared(g, gckeyN(n))) {  /* key is not marked (yet)? *///能否移除
+        hasclears = 1;  /* table must be cleared *///hasclears设置位true
+        if (valiswhite(gval(n)))  /* value not marked yet? *///回收对象是白色
+          hasww = 1;  /* white-white entry *///hasww设置位true
+      }
+      else if (valiswhite(gval(n))) {  /* value not marked yet? *///回收对象是白色
+        marked = 1; //marked设置为1
+        reallymarkobject(g, gcvalue(gval(n)));  /* mark it now *///标记value
+      }
     }
   }
   /* link table into proper list */
@@ -624,29 +681,84 @@ static int traverseephemeron (global_State *g, Table *h, int inv) {
 }
 
 
+/*
+** Queue table 'h', whose array part has no entries after its first
+** 'alast' slots, to have that empty tail released at the end of the
+** cycle (see 'shrinktables') if it holds most of the array part. Only
+** array parts are trimmed, as that can be done in the middle of a
+** traversal; a hash part keeps its removed entries until the next
+** rehash. A table is only queued after being traversed, so it is alive
+** until then. (Weak tables are not checked, as they are cleared only in
+** the atomic phase.)
+*/
+
+/// @brief 如果表数组部分末尾的空槽位太多,把它加入待压缩队列(只压缩数组部分)
+/// @param g 
+/// @param h 
+/// @param alast 数组部分最后一个非空元素的下标加1
+static void checkshrink (global_State *g, Table *h, unsigned int alast) {
+  unsigned int asize = luaH_realasize(h);
+  if (g->nshrink < LUAI_SHRINKQ &&
+      asize >= LUAI_SHRINKMIN && alast < asize / LUAI_SHRINKRATIO)
+    g->shrinkq[g->nshrink++] = h;
+}
+
+
+/*
+** Check whether 'mode' has character 'c' before its first '\0'. Works
+** without '\0' after its bytes too, as 'mode' can be an open string
+** (see lstring.c), and it cannot be copied during a collection.
+*/
+
+/// @brief 检查弱表模式字符串'mode'中'\0'之前是否有字符'c'
+static int modechr (const TString *mode, int c) {
+  const char *s = getstr(mode);
+  size_t l = tsslen(mode);
+  for (; l > 0 && *s != '\0'; s++, l--) {
+    if (*s == c)
+      return 1;
+  }
+  return 0;
+}
+
 /// @brief 遍历strong key, strong value情况
 //    1. 标记 数组部分
 //       对value进行标记
 //    2.hash 部分
 //       value is nil: 移除它
 //       value is not nil: 标记 key, 标记 value
+//    增量rehash中的表先把旧hash部分剩下的条目迁移完
 /// @param g 
 /// @param h 
 static void traversestrongtable (global_State *g, Table *h) {
-  Node *n, *limit = gnodelast(h);//得到最后一个元素
+  Table *p;
   unsigned int i;
+  unsigned int alast = 0;  /* slots in use end here in the array part */
   unsigned int asize = luaH_realasize(h);//得到数组的真实长度
-  for (i = 0; i < asize; i++)  /* traverse array part *///遍历数组
+  luaH_finishmove(g, h);  /* end a pending incremental rehash */
+  for (i = 0; i < asize; i++) {  /* traverse array part *///遍历数组
     markvalue(g, &h->array[i]);//进行标记
-  for (n = gnode(h, 0); n < limit; n++) {  /* traverse hash part *///遍历hash
-    if (isempty(gval(n)))  /* entry is empty? *///如果是nil
-      clearkey(n);  /* clear its key *///删除它
-    else {
-      lua_assert(!keyisnil(n));
-      markkey(g, n);//标记key
-      markvalue(g, gval(n));//标记Value
+    if (!isempty(&h->array[i]))
+      alast = i + 1;
+  }
+  if (h->shape != NULL) {  /* traverse fields (keys are marked apart) */
+    for (i = 0; i < cast_uint(h->shape->nkeys); i++)
+      markvalue(g, &h->fields[i]);
+  }
+  for (p = h; p != NULL; p = oldhashpart(p)) {  /* each hash part */
+    Node *n, *limit = gnodelast(p);//得到最后一个元素
+    for (n = gnode(p, 0); n < limit; n++) {  /* traverse hash part *///遍历hash
+      if (isempty(gval(n)))  /* entry is empty? *///如果是nil
+        clearkey(n);  /* clear its key *///删除它
+      else {
+        lua_assert(!keyisnil(n));
+        markkey(g, n);//标记key
+        markvalue(g, gval(n));//标记Value
+      }
     }
   }
+  if (g->gcshrink && !isfrozen(h))  /* (frozen tables are already packed) */
+    checkshrink(g, h, alast);
   genlink(g, obj2gco(h));
 }
 
@@ -685,12 +797,14 @@ static void traversestrongtable (global_State *g, Table *h) {
 /// @param h 
 /// @return 返回工作单元数量
 static lu_mem traversetable (global_State *g, Table *h) {
-  const char *weakkey, *weakvalue;
+  int weakkey, weakvalue;
   const TValue *mode = gfasttm(g, h->metatable, TM_MODE);//从元表中获取弱表信息
   markobjectN(g, h->metatable);//对object标记
+  if (h->shape != NULL)  /* its keys are marked in 'atomic' */
+    luaH_markshape(h->shape);//标记表的shape
   if (mode && ttisstring(mode) &&  /* is there a weak mode? *///是weak mode
-      (cast_void(weakkey = strchr(svalue(mode), 'k')),//得到key
-       cast_void(weakvalue = strchr(svalue(mode), 'v')),//得到value
+      (cast_void(weakkey = modechr(tsvalue(mode), 'k')),//得到key
+       cast_void(weakvalue = modechr(tsvalue(mode), 'v')),//得到value
        (weakkey || weakvalue))) {  /* is really weak? *///如果有weakkey或者有weakvalue 或者两者存在
     if (!weakkey)  /* strong keys? *///strong key, weak value
       traverseweakvalue(g, h);//// 遍历strong key, strong value情况
@@ -701,7 +815,9 @@ static lu_mem traversetable (global_State *g, Table *h) {
   }
   else  /* not weak *///strong key, strong value
     traversestrongtable(g, h);// 遍历strong key, strong value情况
-  return 1 + h->alimit + 2 * allocsizenode(h);//返回工作单元数量
+  return 1 + h->alimit + 2 * allocsizenode(h) +  //返回工作单元数量
+         ((h->shape != NULL) ? h->shape->nkeys : 0) +
+         ((h->oldhash != NULL) ? 2 * sizenode(oldhashpart(h)) : 0);
 }
 
 /// @brief 标记userdata: metatable, upvalues,
@@ -739,7 +855,12 @@ static int traverseproto (global_State *g, Proto *f) {
     markobjectN(g, f->p[i]);
   for (i = 0; i < f->sizelocvars; i++)  /* mark local-variable names *///标记局部变量
     markobjectN(g, f->locvars[i].varname);
-  return 1 + f->sizek + f->sizeupvalues + f->sizep + f->sizelocvars;//返回工作单元数量
+  for (i = 0; i < f->sizetemplates; i++) {  /* mark template shapes *///标记表构造模板的shape
+    if (f->templates[i].shape != NULL)  /* (NULL while being built) */
+      luaH_markshape(f->templates[i].shape);
+  }
+  return 1 + f->sizek + f->sizeupvalues + f->sizep + f->sizelocvars +
+         f->sizetemplates;//返回工作单元数量
 }
 
 /// @brief 标记 C闭包中所有的 upvalues 
@@ -904,13 +1025,17 @@ static void convergeephemerons (global_State *g) {
 static void clearbykeys (global_State *g, GCObject *l) {
   for (; l; l = gco2t(l)->gclist) {//遍历l链表
     Table *h = gco2t(l); //得到table
-    Node *limit = gnodelast(h);//获取hash数组最后一个元素
-    Node *n;
-    for (n = gnode(h, 0); n < limit; n++) {//遍历hash
-      if (iscleared(g, gckeyN(n)))  /* unmarked key? *///如果key能移除
-        setempty(gval(n));  /* remove entry *///移除它
-      if (isempty(gval(n)))  /* is entry empty? *///如果n值是nil
-        clearkey(n);  /* clear its key *///移除key
+    Table *p;
+    luaH_chainchange(g, h);
+    for (p = h; p != NULL; p = oldhashpart(p)) {  /* each hash part */
+      Node *limit = gnodelast(p);//获取hash数组最后一个元素
+      Node *n;
+      for (n = gnode(p, 0); n < limit; n++) {//遍历hash
+        if (iscleared(g, gckeyN(n)))  /* unmarked key? *///如果key能移除
+          setempty(gval(n));  /* remove entry *///移除它
+        if (isempty(gval(n)))  /* is entry empty? *///如果n值是nil
+          clearkey(n);  /* clear its key *///移除key
+      }
     }
   }
 }
@@ -928,19 +1053,29 @@ static void clearbykeys (global_State *g, GCObject *l) {
 static void clearbyvalues (global_State *g, GCObject *l, GCObject *f) {
   for (; l != f; l = gco2t(l)->gclist) {//遍历l到f的链表
     Table * h = gco2t(l);//转换成table
-    Node *n, *limit = gnodelast(h);//获取hash数组最后一个元素
+    Table *p;
     unsigned int i;
     unsigned int asize = luaH_realasize(h);//得到数组的真实长度
+    luaH_chainchange(g, h);
     for (i = 0; i < asize; i++) {//遍历数组
       TValue *o = &h->array[i];
       if (iscleared(g, gcvalueN(o)))  /* value was collected? *///如果能被回收
         setempty(o);  /* remove entry *///移除
     }
-    for (n = gnode(h, 0); n < limit; n++) {//遍历数组
-      if (iscleared(g, gcvalueN(gval(n))))  /* unmarked value? *///值能被回收
-        setempty(gval(n));  /* remove entry *///移除
-      if (isempty(gval(n)))  /* is entry empty? *///值是nil
-        clearkey(n);  /* clear its key *///清除key
+    if (h->shape != NULL) {  /* fields of a shape */
+      for (i = 0; i < cast_uint(h->shape->nkeys); i++) {
+        if (iscleared(g, gcvalueN(&h->fields[i])))  /* value was collected? */
+          setempty(&h->fields[i]);  /* remove entry */
+      }
+    }
+    for (p = h; p != NULL; p = oldhashpart(p)) {  /* each hash part */
+      Node *n, *limit = gnodelast(p);//获取hash数组最后一个元素
+      for (n = gnode(p, 0); n < limit; n++) {//遍历数组
+        if (iscleared(g, gcvalueN(gval(n))))  /* unmarked value? *///值能被回收
+          setempty(gval(n));  /* remove entry *///移除
+        if (isempty(gval(n)))  /* is entry empty? *///值是nil
+          clearkey(n);  /* clear its key *///清除key
+      }
     }
   }
 }
@@ -994,7 +1129,7 @@ static void freeobj (lua_State *L, GCObject *o) {
     }
     case LUA_VLNGSTR: {//长字符串
       TString *ts = gco2ts(o);
-      luaM_freemem(L, ts, sizelstring(ts->u.lnglen));//释放长字符串
+      luaS_freelngstr(L, ts);//释放长字符串
       break;
     }
     default: lua_assert(0);
@@ -1083,20 +1218,59 @@ static void entersweep(lua_State* L) {
 */
 
 /*
-** If possible, shrink string table.
+** Trim the array parts of the tables queued by 'checkshrink'. That
+** only releases memory, and a failure leaves a table as it was;
+** emergency collections are kept off all the same.
+*/
+
+/// @brief 释放checkshrink放入队列的表的数组部分末尾的空槽位
+/// @param L 
+/// @param g 
+static void shrinktables (lua_State *L, global_State *g) {
+  int i;
+  lu_byte oldstopem = g->gcstopem;
+  l_mem olddebt = g->GCdebt;
+  g->gcstopem = 1;
+  for (i = 0; i < g->nshrink; i++)
+    luaH_trimarray(L, g->shrinkq[i]);
+  g->gcstopem = oldstopem;
+  g->GCestimate += g->GCdebt - olddebt;  /* correct estimate */
+}
+
+
+/*
+** If possible, shrink string table and tables queued for compaction.
 */
 
-/// @brief 如果可能，收缩字符串表
+/// @brief 如果可能，收缩字符串表以及等待压缩的表
 /// @param L 
 /// @param g 
 static void checkSizes (lua_State *L, global_State *g) {
   if (!g->gcemergency) {//不是紧急回收
-    if (g->strt.nuse < g->strt.size / 4) {  /* string table too big? *///字符串太大 里面的元素大于hash表的4分之一
+    if (g->strt.nuse < g->strt.size / 4 &&  /* string table too big? *///字符串太大 里面的元素大于hash表的4分之一
+        g->strt.oldhash == NULL) {  /* and not being resized already? */
       l_mem olddebt = g->GCdebt;//得到需要回收的量
       luaS_resize(L, g->strt.size / 2);
       g->GCestimate += g->GCdebt - olddebt;  /* correct estimate *///计算存活下来的数量
     }
+    shrinktables(L, g);
   }
+  g->nshrink = 0;
+}
+
+
+/*
+** Free the table shapes taken out of use by the last atomic phase (see
+** 'markshapes'), now that the dead tables pointing to them are gone.
+*/
+
+/// @brief 释放上一次原子阶段摘下的表shape
+/// @param L 
+/// @param g 
+static void sweepshapes (lua_State *L, global_State *g) {
+  l_mem olddebt = g->GCdebt;
+  luaH_sweepshapes(L);
+  g->GCestimate += g->GCdebt - olddebt;  /* correct estimate */
 }
 
 
@@ -1593,6 +1767,7 @@ static void atomic2gen (lua_State *L, global_State *g) {
   g->finobjrold = g->finobjold1 = g->finobjsur = g->finobj;
 
   sweep2old(L, &g->tobefnz);//清除tobefnz链表
+  sweepshapes(L, g);//释放不再使用的表shape
 
   g->gckind = KGC_GEN;//设置成分代gc类型
   g->lastatomic = 0;
@@ -1886,6 +2061,11 @@ static lu_mem atomic (lua_State *L) {
   work += propagateall(g);  /* remark, to propagate 'resurrection' *///gray链表可能有会有新的对象重新标记灰色链表节点
   convergeephemerons(g);//不断遍历 weak table 的 ephemerons 链表
   /* at this point, all resurrected objects are marked. */
+  /* in a complete cycle, every table alive has marked its shape;
+     emergency collections may run while a new shape is not in use yet */
+  if (g->rootshape != NULL)  /* mark keys of table shapes *///标记表shape中的键
+    markshapes(g, &g->rootshape->child,
+               g->gckind == KGC_INC && !g->gcemergency);
   /* remove dead objects from weak tables */
   clearbykeys(g, g->ephemeron);  /* clear keys from all ephemeron tables *///清除g->ephemeron中所有未标记的值
   clearbykeys(g, g->allweak);  /* clear keys from all 'allweak' tables *///清除g->allweak中所有未标记的值
@@ -1910,6 +2090,8 @@ static int sweepstep (lua_State *L, global_State *g,
   if (g->sweepgc) {
     l_mem olddebt = g->GCdebt;
     int count;
+    if (g->strt.oldhash != NULL)  /* string table being resized? */
+      luaS_movebuckets(L, GCSWEEPMAX);  /* move some of its buckets too */
     g->sweepgc = sweeplist(L, g->sweepgc, GCSWEEPMAX, &count);
     g->GCestimate += g->GCdebt - olddebt;  /* update estimate */
     return count;
@@ -1966,6 +2148,7 @@ static lu_mem singlestep (lua_State *L) {
     }
     case GCSswpend: {  /* finish sweeps */
       checkSizes(L, g);
+      sweepshapes(L, g);
       g->gcstate = GCScallfin;
       work = 0;
       break;
@@ -2091,6 +2274,11 @@ void luaC_fullgc (lua_State *L, int isemergency) {
     fullinc(L, g);//以增量模式执行完整收集
   else
     fullgen(L, g);//在分代模式下执行完整集合
+  if (!isemergency && g->strt.oldhash != NULL) {  /* string table resizing? */
+    l_mem olddebt = g->GCdebt;
+    luaS_movebuckets(L, g->strt.oldsize);  /* already a long pause: finish it */
+    g->GCestimate += g->GCdebt - olddebt;  /* correct estimate */
+  }
   g->gcemergency = 0;//设置成0代表不紧急回收
 }
 
@@ -56,6 +56,7 @@ static const luaL_Reg loadedlibs[] = {
   {LUA_STRLIBNAME, luaopen_string},
   {LUA_MATHLIBNAME, luaopen_math},
   {LUA_UTF8LIBNAME, luaopen_utf8},
+  {LUA_ARRAYLIBNAME, luaopen_array},
   {LUA_DBLIBNAME, luaopen_debug},
   {NULL, NULL}
 };
@@ -114,6 +114,23 @@ static const void *const disptab[NUM_OPCODES] = {
 &&L_OP_CLOSURE,
 &&L_OP_VARARG,
 &&L_OP_VARARGPREP,
-&&L_OP_EXTRAARG
+&&L_OP_EXTRAARG,
+&&L_OP_ADDII,
+&&L_OP_ADDFF,
+&&L_OP_SUBII,
+&&L_OP_SUBFF,
+&&L_OP_MULII,
+&&L_OP_MULFF,
+&&L_OP_DIVFF,
+&&L_OP_LTII,
+&&L_OP_LTFF,
+&&L_OP_LEII,
+&&L_OP_LEFF,
+&&L_OP_GETTABUPFIELD,
+&&L_OP_GETFIELDFIELD,
+&&L_OP_GETFIELDCALL,
+&&L_OP_MOVEMOVE,
+&&L_OP_MOVECALL,
+&&L_OP_NEWTEMPLATE
 
 };
@@ -181,6 +181,22 @@ typedef LUAI_UACINT l_uacInt;
 #endif
 
 
+/*
+** non-inlined function (keeps rarely used code out of a hot caller)
+*/
+#if !defined(l_noinline)
+
+#if defined(__GNUC__)
+#define l_noinline	__attribute__((noinline))
+#elif defined(_MSC_VER) && _MSC_VER >= 1300
+#define l_noinline	__declspec(noinline)
+#else
+#define l_noinline	/* empty */
+#endif
+
+#endif
+
+
 /*
 ** Inline functions
 */
@@ -201,8 +217,10 @@ typedef LUAI_UACINT l_uacInt;
 */
 #if LUAI_IS32INT
 typedef unsigned int l_uint32;
+typedef int l_int32;
 #else
 typedef unsigned long l_uint32;
+typedef long l_int32;
 #endif
 
 typedef l_uint32 Instruction;//指令类型
@@ -231,6 +249,34 @@ typedef l_uint32 Instruction;//指令类型
 #endif
 
 
+/*
+** String hash. When the compiler has a 64-bit unsigned type, 'luaS_hash'
+** reads strings 8 bytes at a time and mixes them with 64-bit products
+** (in the style of wyhash), keyed by the state seed. Define
+** LUAI_BYTEHASH to use the original hash, which reads one byte per step.
+*/
+#if !defined(LUAI_BYTEHASH) && defined(ULLONG_MAX) && \
+    ((ULLONG_MAX >> 31) >> 31) >= 3
+#define LUAI_WORDHASH
+typedef unsigned long long l_uint64;
+#endif
+
+
+/*
+** Maximum number of shapes (shared key layouts of record tables) a
+** state keeps, and maximum number of keys in a table using a shape.
+** (LUAI_MAXSHAPEKEYS must fit in a byte; LUAI_MAXSHAPES == 0 disables
+** shapes.)
+*/
+#if !defined(LUAI_MAXSHAPES)
+#define LUAI_MAXSHAPES		1024
+#endif
+
+#if !defined(LUAI_MAXSHAPEKEYS)
+#define LUAI_MAXSHAPEKEYS	32
+#endif
+
+
 /*
 ** Size of cache for strings in the API. 'N' is the number of
 ** sets (better be a prime) and "M" is the size of each set (M == 1
@@ -242,6 +288,80 @@ typedef l_uint32 Instruction;//指令类型
 #endif
 
 
+/*
+** Size of the cache of lookups through '__index' chains (see
+** 'luaV_finishget'). It is a direct-mapped cache; must be a power of 2.
+*/
+#if !defined(INDEXCACHE_N)
+#define INDEXCACHE_N		256
+#endif
+
+
+/*
+** Hash parts with at least LUAI_INCRHASH nodes grow incrementally:
+** instead of rehashing the whole table at once, the table gets a new
+** hash part and each later insertion moves LUAI_HASHSTEP entries of
+** the old one into it (see 'luaH_newkey'). The string table resizes
+** the same way, moving LUAI_HASHSTEP buckets per new string (see
+** 'luaS_resize').
+*/
+#if !defined(LUAI_INCRHASH)
+#define LUAI_INCRHASH		(1 << 14)
+#endif
+
+#if !defined(LUAI_HASHSTEP)
+#define LUAI_HASHSTEP		4
+#endif
+
+
+/*
+** A substring of a long string with at least LUAI_MINSUBSTR bytes is
+** a slice that references the bytes of its parent instead of a copy
+** (see 'luaS_newsub'), unless it is smaller than 1/LUAI_SUBRATIO of the
+** memory block it would keep alive.
+*/
+#if !defined(LUAI_MINSUBSTR)
+#define LUAI_MINSUBSTR		128
+#endif
+
+#if !defined(LUAI_SUBRATIO)
+#define LUAI_SUBRATIO		256
+#endif
+
+
+/*
+** When table shrinking is on ('collectgarbage("shrink")'), the collector
+** releases the empty tail of an array part with at least LUAI_SHRINKMIN
+** slots whose entries all lie in its first 1/LUAI_SHRINKRATIO. (Hash
+** parts are left alone; see 'checkshrink'.) At most LUAI_SHRINKQ tables
+** are trimmed in each cycle; the others wait for the next one.
+*/
+#if !defined(LUAI_SHRINKRATIO)
+#define LUAI_SHRINKRATIO	4
+#endif
+
+#if !defined(LUAI_SHRINKMIN)
+#define LUAI_SHRINKMIN		64
+#endif
+
+#if !defined(LUAI_SHRINKQ)
+#define LUAI_SHRINKQ		32
+#endif
+
+
+/*
+** 'table.freeze' doubles the hash part of a table at most
+** LUAI_FREEZEGROW times looking for a layout where every search reads
+** a single group of nodes. When it finds one, the frozen table keeps
+** up to 2^LUAI_FREEZEGROW times the nodes a rehash would give it (4x
+** with the default); otherwise it goes back to that size. 0 keeps
+** frozen tables at their minimal size.
+*/
+#if !defined(LUAI_FREEZEGROW)
+#define LUAI_FREEZEGROW		2
+#endif
+
+
 /* minimum size for string buffer */
 #if !defined(LUA_MINBUFFER)
 #define LUA_MINBUFFER	32
@@ -217,6 +217,9 @@ typedef StackValue *StkId;
 /* Value returned for a key not found in a table (absent key) */
 #define LUA_VABSTKEY	makevariant(LUA_TNIL, 2) //表中没有找到key时候返回的类型
 
+/* Entry of an old hash part moved to the table's own part (see ltable.c) */
+#define LUA_VMOVED	makevariant(LUA_TNIL, 3) //旧hash部分中已经迁移走的槽位
+
 
 /* macro to test for (any kind of) nil */
 #define ttisnil(v)		checktype((v), LUA_TNIL) //基础类型是不是nil类型
@@ -448,7 +451,7 @@ typedef struct GCObject {
 typedef struct TString {
   CommonHeader;//代表需要GC
   lu_byte extra;  /* reserved words for short strings; "has hash" for longs */// 用于标记是否是虚拟机保留的字符串，如果这个值为1，那么不会GC（保留字符串即是lua中的关键字） 长字符串用于判断hash值是否已经创建,0为未创建，如果是1那么就说明设置了
-  lu_byte shrlen;  /* length for short strings *///短字符串的长度(因为lua并不以\0结尾来识别字符串的长度，故需要一个len域来记录其长度)
+  lu_byte shrlen;  /* length for short strings; kind for long ones *///短字符串的长度(因为lua并不以\0结尾来识别字符串的长度，故需要一个len域来记录其长度);长字符串用来记录内容存放的方式(LSTRREG/LSTRBUF/LSTRSUB/LSTREXT)
   unsigned int hash;//字符串的hash值。
   // 短串：该hash值是在创建时就计算出来的
  	// 长串：只有真正需要它的hash值时，才会手动调用luaS_hashlongstr函数生成该值,lua内部现在只有在把长串作为table的key时，才会去计算它。
@@ -456,15 +459,28 @@ typedef struct TString {
     size_t lnglen;  /* length for long strings *///表示长字符的长度
     struct TString *hnext;  /* linked list for hash table *///代表链接下一个字符串
   } u;
-  char contents[1];//字符串存储的地方,因为是c语言后面还会在加个'\0' 所以字符串的总大小是 #define sizelstring(l)  (offsetof(TString, contents) + ((l) + 1) * sizeof(char))
+  /* short strings keep their bytes starting at field 'contents' */
+  char *contents;  /* pointer to content in long strings *///长字符串内容的指针;短字符串的内容直接从这个字段的位置开始存放,所以短字符串的总大小是 #define sizelstring(l)  (offsetof(TString, contents) + ((l) + 1) * sizeof(char))
+  struct TString *owner;  /* string holding the content of buffers/slices *///内容放在其他字符串中的长字符串(LSTRBUF/LSTRSUB):内容所在的字符串
 } TString;
 
 
+/*
+** Kinds of long strings (kept in field 'shrlen')
+*/
+#define LSTRREG		0  /* content right after the header *///内容紧跟在头部后面
+#define LSTRBUF		1  /* content in the buffer of string 'owner' *///内容放在'owner'字符串的缓冲区中
+#define LSTRSUB		2  /* content is a slice of string 'owner' *///内容是'owner'字符串的一个片段
+#define LSTREXT		3  /* external content, not owned by Lua *///内容在外部内存中(由C代码提供,不属于Lua)
+
 
 /*
 ** Get the actual string (array of bytes) from a 'TString'.
 */
-#define getstr(ts)  ((ts)->contents)//获取内容
+#define getshrstr(ts)	cast_charp(&(ts)->contents)//获取短字符串内容
+#define getlngstr(ts)	((ts)->contents)//获取长字符串内容
+#define getstr(ts)  \
+	((ts)->tt == LUA_VSHRSTR ? getshrstr(ts) : getlngstr(ts))//获取内容
 
 
 /* get the actual string (array of bytes) from a Lua value */
@@ -502,6 +518,12 @@ typedef struct TString {
 
 #define pvalueraw(v)	((v).p)//获取原生的light userdata指针
 
+/*
+** Typed arrays are full userdata without user values whose memory
+** block is a vector of numbers of type 'atype' (see LUA_AINT8 etc.).
+*/
+#define ttisarray(o)	(ttisfulluserdata(o) && uvalue(o)->atype != 0)//是不是类型化数组
+
 // 将obj指向的对象 Value 的 union 元素设为(void *)类型 void*这里是light userdata类型, 并指向 x 指向的对象;
 // Tvalue->tt_ 设为LUA_VLIGHTUSERDATA类型
 #define setpvalue(obj,x) \
@@ -535,6 +557,7 @@ typedef union UValue {
 typedef struct Udata {
   CommonHeader;
   unsigned short nuvalue;  /* number of user values *///用户自定义值长度
+  lu_byte atype;  /* element type, for typed arrays (0 otherwise) *///类型化数组的元素类型,普通userdata为0
   size_t len;  /* number of bytes *///记录UserData长度
   struct Table *metatable;//UserData数据独立元表
   GCObject *gclist;//GC相关的链表
@@ -556,6 +579,7 @@ typedef struct Udata {
 typedef struct Udata0 {
   CommonHeader;
   unsigned short nuvalue;  /* number of user values *////用户自定义值长度
+  lu_byte atype;  /* element type, for typed arrays (0 otherwise) */
   size_t len;  /* number of bytes *///记录UserData长度
   struct Table *metatable;//UserData数据独立元表
   union {LUAI_MAXALIGN;} bindata;//指向C语言结构体的指针,便于后面直接将这部分内存直接转换成结构体 例如: xxxxx = (struct xxxxx *)lua_newuserdata(L, sizeof(struct xxxxx));
@@ -626,6 +650,25 @@ typedef struct AbsLineInfo {
   int line;//关联的代码行
 } AbsLineInfo;
 
+
+/*
+** Template of a table constructor whose keys are all distinct constant
+** short strings: the shape of the tables it builds and the initial
+** values of their fields (the constant ones; nil for values computed at
+** run time). The constructor's OP_NEWTABLE (at 'pc') becomes an
+** OP_NEWTEMPLATE that copies them, and then skips the first 'skip'
+** stores of the constructor, which only set constant fields.
+*/
+
+/// @brief 表构造模板(所有键都是不同的短字符串常量的表构造式)
+typedef struct TableTemplate {
+  struct Shape *shape;  /* shape of the new tables *///新表的shape
+  TValue *values;  /* initial values of the fields *///字段的初始值
+  int nfields;  /* size of 'values' */
+  int pc;  /* position of the constructor's OP_NEWTABLE *///构造式的OP_NEWTABLE指令位置
+  int skip;  /* number of leading stores made useless by 'values' *///可以跳过的前几条常量赋值指令数量
+} TableTemplate;
+
 /*
 ** Function Prototypes
 */
@@ -646,6 +689,8 @@ typedef struct Proto {
   int sizep;  /* size of 'p' *///子函数原型个数
   int sizelocvars;//局部变量个数
   int sizeabslineinfo;  /* size of 'abslineinfo' *///绝对行号abslineinfo个数
+  int sizeicache;  /* size of 'icache' *///内联缓存icache个数
+  int sizetemplates;  /* size of 'templates' *///表构造模板个数
   int linedefined;  /* debug information  *///函数定义开始处的行号(debug版字节码才有该信息）
   int lastlinedefined;  /* debug information  *///函数定义结束处的行号(debug版字节码才有该信息）
   TValue *k;  /* constants used by the function *///常量表
@@ -654,6 +699,8 @@ typedef struct Proto {
   Upvaldesc *upvalues;  /* upvalue information *///upvalue表
   ls_byte *lineinfo;  /* information about source lines (debug information) *///相对行号信息(debug版字节码才有该信息）
   AbsLineInfo *abslineinfo;  /* idem *///绝对行号信息debug版字节码才有该信息）
+  unsigned int *icache;  /* inline caches (one node index per instruction) *///每条指令的内联缓存(缓存节点下标)
+  TableTemplate *templates;  /* templates for table constructors *///表构造模板
   LocVar *locvars;  /* information about local variables (debug information) *///局部变量表(debug版字节码才有该信息）
   TString  *source;  /* used for debug information *///源代码文件名(debug版字节码才有该信息）
   GCObject *gclist;//灰对象列表，最后由g->gray串连起来
@@ -823,7 +870,7 @@ typedef union Node {
   struct NodeKey {
     TValuefields;  /* fields for value *///Value 联合体 + 类型标签 存储的是key的值
     lu_byte key_tt;  /* key type *///代表key的类型标记
-    int next;  /* for chaining *///用于哈希冲突的时候链接向下一个位置
+    lu_byte key_moved;  /* came from an old hash part (see 'movehash') *///是否是从旧hash部分迁移过来的
     Value key_val;  /* key value *///代表key的具体数值
   } u;
   TValue i_val;  /* direct access to node's value as a proper 'TValue' *///TValue存储了数据值 的类型与数据值，就是上面的i_val里面的tt_为整型,i_val里面的value_为2222 其实这里的数据和TValuefields里面的数据一样的，这么写只是为了提供一个快捷访问
@@ -858,19 +905,35 @@ typedef union Node {
 #define setrealasize(t)		((t)->flags &= cast_byte(~BITRAS))//设置flags的第8为0 
 #define setnorealasize(t)	((t)->flags |= BITRAS)//根据flags的第8为判断alimit是否不为数组部分的实际大小
 
+/*
+** Bit 6 of 'flags' marks tables that took part in a lookup stored in
+** the cache of '__index' chains; any change to them invalidates it.
+** Frozen tables have it set too, so that a single test tells whether a
+** change needs the slow path (see 'luaH_checkwrite').
+*/
+//第7位为1代表该表是某条__index链的成员,修改它需要让链缓存失效
+#define BITCHAIN	(1 << 6)
+#define ischainmember(t)	((t)->flags & BITCHAIN)
+#define setchainmember(t)	((t)->flags |= BITCHAIN)
+
 /// @brief 按照key的数据类型分成数组部分和散列表部分，
 // 数组部分用于存储key值在数组大小范围内的键值对，其余数组部分不能存储的键值对则存储在散列表部分
 typedef struct Table {
   CommonHeader;
   lu_byte flags;  /* 1<<p means tagmethod(p) is not present *///用于缓存该表中实现了哪些元方法
   lu_byte lsizenode;  /* log2 of size of 'node' array *///  哈希部分的长度对数 注意不是实际大小 1 << lsizenode才能得到实际的size(结果为当前内存分配node数量(包括空的或使用的))
+  lu_byte frozen;  /* true if the table cannot be changed *///为1时表被冻结,不能再修改
+  lu_byte trimmed;  /* true if 'luaH_trimarray' shrank it since last resize *///为1时数组部分在上次resize后被luaH_trimarray缩小过
   
   unsigned int alimit;  /* "limit" of 'array' array *///在大部份情况下为数组的容量（2次幂数）
   TValue *array;  /* array part *///指向数组部分的首地址
   Node *node;//为Node组成的数组 闭散列 哈希表存储在这
-  Node *lastfree;  /* any free position is before this position *///记录上一次从node数据块（即散列部分）末尾分配空闲Node的最后位置
+  Node *lastfree;  /* 'lastfree - node' never-used nodes may still be taken *///距离node的偏移为散列部分还能使用的空闲节点数,为NULL代表使用dummynode
   struct Table *metatable;//存放该表的元表
   GCObject *gclist;//GC相关的 
+  struct Shape *shape;  /* shared key layout (NULL if using 'node') *///共享的键布局,为NULL时使用node哈希部分
+  TValue *fields;  /* values for the keys in 'shape' *///按shape中键的顺序存放的值
+  struct OldHash *oldhash;  /* hash part still being moved (or NULL) *///增量rehash中尚未迁移完的旧hash部分
 } Table;
 
 
@@ -932,6 +995,17 @@ typedef struct Table {
 /* size of buffer for 'luaO_utf8esc' function */
 #define UTF8BUFFSZ	8
 
+
+/*
+** Maximum length of the conversion of a number to a string. Must be
+** enough to accommodate both LUA_INTEGER_FMT and LUA_NUMBER_FMT.
+** (For a long long int, this is 19 digits plus a sign and a final '\0',
+** adding to 21. For a long double, it can go to a sign, 33 digits,
+** the dot, an exponent letter, an exponent sign, 5 exponent digits,
+** and a final '\0', adding to 43.)
+*/
+#define MAXNUMBER2STR	44
+
 LUAI_FUNC int luaO_utf8esc (char *buff, unsigned long x);
 LUAI_FUNC int luaO_ceillog2 (unsigned int x);
 LUAI_FUNC int luaO_rawarith (lua_State *L, int op, const TValue *p1,
@@ -941,6 +1015,7 @@ LUAI_FUNC void luaO_arith (lua_State *L, int op, const TValue *p1,
 LUAI_FUNC size_t luaO_str2num (const char *s, TValue *o);
 LUAI_FUNC int luaO_hexavalue (int c);
 LUAI_FUNC void luaO_tostring (lua_State *L, TValue *obj);
+LUAI_FUNC int luaO_tostringbuff (const TValue *obj, char *buff);
 LUAI_FUNC const char *luaO_pushvfstring (lua_State *L, const char *fmt,
                                                        va_list argp);
 LUAI_FUNC const char *luaO_pushfstring (lua_State *L, const char *fmt, ...);
@@ -107,5 +107,47 @@ LUAI_DDEF const lu_byte luaP_opmodes[NUM_OPCODES] = {
  ,opmode(0, 1, 0, 0, 1, iABC)		/* OP_VARARG */
  ,opmode(0, 0, 1, 0, 1, iABC)		/* OP_VARARGPREP */
  ,opmode(0, 0, 0, 0, 0, iAx)		/* OP_EXTRAARG */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_ADDII */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_ADDFF */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_SUBII */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_SUBFF */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_MULII */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_MULFF */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_DIVFF */
+ ,opmode(0, 0, 0, 1, 0, iABC)		/* OP_LTII */
+ ,opmode(0, 0, 0, 1, 0, iABC)		/* OP_LTFF */
+ ,opmode(0, 0, 0, 1, 0, iABC)		/* OP_LEII */
+ ,opmode(0, 0, 0, 1, 0, iABC)		/* OP_LEFF */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_GETTABUPFIELD */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_GETFIELDFIELD */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_GETFIELDCALL */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_MOVEMOVE */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_MOVECALL */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_NEWTEMPLATE */
+};
+
+
+/* ORDER OP */
+
+/// @brief 内部指令对应的原始指令
+LUAI_DDEF const lu_byte luaP_opbase[NUM_OPCODES - NUM_BASEOPCODES] = {
+/*  original	   internal opcode  */
+  OP_ADD		/* OP_ADDII */
+ ,OP_ADD		/* OP_ADDFF */
+ ,OP_SUB		/* OP_SUBII */
+ ,OP_SUB		/* OP_SUBFF */
+ ,OP_MUL		/* OP_MULII */
+ ,OP_MUL		/* OP_MULFF */
+ ,OP_DIV		/* OP_DIVFF */
+ ,OP_LT			/* OP_LTII */
+ ,OP_LT			/* OP_LTFF */
+ ,OP_LE			/* OP_LEII */
+ ,OP_LE			/* OP_LEFF */
+ ,OP_GETTABUP		/* OP_GETTABUPFIELD */
+ ,OP_GETFIELD		/* OP_GETFIELDFIELD */
+ ,OP_GETFIELD		/* OP_GETFIELDCALL */
+ ,OP_MOVE		/* OP_MOVEMOVE */
+ ,OP_MOVE		/* OP_MOVECALL */
+ ,OP_NEWTABLE		/* OP_NEWTEMPLATE */
 };
 
@@ -377,12 +377,43 @@ OP_VARARGPREP,/*A	(adjust vararg parameters)			*/// 查看可变参数方式下
 /*函数调用 end*/ 
 
 /*额外参数 begin*/
-OP_EXTRAARG/*	Ax	extra (larger) argument for previous opcode	*///为上一条指令提供额外参数
+OP_EXTRAARG,/*	Ax	extra (larger) argument for previous opcode	*///为上一条指令提供额外参数
 /*额外参数 end*/
+
+/*
+** Internal opcodes, never saved by 'luaU_dump' (see 'luaP_baseop'). The
+** interpreter rewrites an instruction in place into one of the
+** type-specialized variants; 'luaK_finish' marks the first instruction
+** of some frequent pairs with a superinstruction; the parser marks the
+** OP_NEWTABLE of constructors that have a template.
+*/
+/*内部指令(由虚拟机改写生成,不会被编译器生成也不会被dump) begin*/
+OP_ADDII,/*	A B C	R[A] := R[B] + R[C] (integers)			*///整数加
+OP_ADDFF,/*	A B C	R[A] := R[B] + R[C] (floats)			*///浮点加
+OP_SUBII,/*	A B C	R[A] := R[B] - R[C] (integers)			*///整数减
+OP_SUBFF,/*	A B C	R[A] := R[B] - R[C] (floats)			*///浮点减
+OP_MULII,/*	A B C	R[A] := R[B] * R[C] (integers)			*///整数乘
+OP_MULFF,/*	A B C	R[A] := R[B] * R[C] (floats)			*///浮点乘
+OP_DIVFF,/*	A B C	R[A] := R[B] / R[C] (floats)			*///浮点除
+OP_LTII,/*	A B k	if ((R[A] <  R[B]) ~= k) then pc++ (integers)	*///整数小于测试
+OP_LTFF,/*	A B k	if ((R[A] <  R[B]) ~= k) then pc++ (floats)	*///浮点小于测试
+OP_LEII,/*	A B k	if ((R[A] <= R[B]) ~= k) then pc++ (integers)	*///整数小于等于测试
+OP_LEFF,/*	A B k	if ((R[A] <= R[B]) ~= k) then pc++ (floats)	*///浮点小于等于测试
+
+/* superinstructions: the next instruction runs without a new dispatch */
+OP_GETTABUPFIELD,/* A B C	OP_GETTABUP followed by OP_GETFIELD		*///GETTABUP后紧跟GETFIELD
+OP_GETFIELDFIELD,/* A B C	OP_GETFIELD followed by OP_GETFIELD		*///GETFIELD后紧跟GETFIELD
+OP_GETFIELDCALL,/* A B C	OP_GETFIELD followed by OP_CALL			*///GETFIELD后紧跟CALL
+OP_MOVEMOVE,/*	A B	OP_MOVE followed by OP_MOVE			*///MOVE后紧跟MOVE
+OP_MOVECALL,/*	A B	OP_MOVE followed by OP_CALL			*///MOVE后紧跟CALL
+
+OP_NEWTEMPLATE/* A B C k	R[A] := copy of the constructor's template	*///用表构造模板新建一个表
+/*内部指令 end*/
 } OpCode;
 
 
-#define NUM_OPCODES	((int)(OP_EXTRAARG) + 1)//指令数量
+#define NUM_BASEOPCODES	((int)(OP_EXTRAARG) + 1)//编译器生成的指令数量
+#define NUM_OPCODES	((int)(OP_NEWTEMPLATE) + 1)//指令数量(包括内部指令)
 
 
 
@@ -420,6 +451,9 @@ OP_EXTRAARG/*	Ax	extra (larger) argument for previous opcode	*///为上一条指
   power of 2) plus 1, or zero for size zero. If not k, the array size
   is C. Otherwise, the array size is EXTRAARG _ C.
 
+  (*) OP_NEWTEMPLATE keeps the arguments of its OP_NEWTABLE; the index
+  of its template is in the inline cache of the instruction.
+
   (*) For comparisons, k specifies what condition the test should accept
   (true or false).
 
@@ -466,6 +500,18 @@ LUAI_DDEC(const lu_byte luaP_opmodes[NUM_OPCODES];)
 #define testOTMode(m)	(luaP_opmodes[m] & (1 << 6))//检查指令是否可以将值放到栈顶,供后面的指令使用（当C == 0时） 
 #define testMMMode(m)	(luaP_opmodes[m] & (1 << 7))//检查指令是否元方法指令
 
+/*
+** Original opcode of an (internal or not) opcode. Everything that reads
+** code produced by the compiler (debug information, 'luaU_dump', 'luac')
+** should use it instead of the raw opcode.
+*/
+LUAI_DDEC(const lu_byte luaP_opbase[NUM_OPCODES - NUM_BASEOPCODES];)
+
+//获取指令的原始指令(内部指令转换为编译器生成的指令)
+#define luaP_baseop(o)	((o) < NUM_BASEOPCODES ? (o) \
+			 : cast(OpCode, luaP_opbase[(o) - NUM_BASEOPCODES]))
+#define GET_BASEOPCODE(i)	luaP_baseop(GET_OPCODE(i))//获取指令i的原始指令
+
 /* "out top" (set top for next instruction) */
 //将值放到栈顶,供后面的指令使用（当C == 0时） 
 #define isOT(i)  \
@@ -103,6 +103,23 @@ static const char *const opnames[] = {
   "VARARG",
   "VARARGPREP",
   "EXTRAARG",
+  "ADDII",
+  "ADDFF",
+  "SUBII",
+  "SUBFF",
+  "MULII",
+  "MULFF",
+  "DIVFF",
+  "LTII",
+  "LTFF",
+  "LEII",
+  "LEFF",
+  "GETTABUPFIELD",
+  "GETFIELDFIELD",
+  "GETFIELDCALL",
+  "MOVEMOVE",
+  "MOVECALL",
+  "NEWTEMPLATE",
   NULL
 };
 
@@ -949,6 +949,7 @@ static void open_func (LexState *ls, FuncState *fs, BlockCnt *bl) {
   fs->nk = 0;
   fs->nabslineinfo = 0;
   fs->np = 0;
+  fs->ntemplates = 0;
   fs->nups = 0;
   fs->ndebugvars = 0;
   fs->nactvar = 0;
@@ -973,6 +974,9 @@ static void close_func (LexState *ls) {
   lua_assert(fs->bl == NULL);
   luaK_finish(fs);
   luaM_shrinkvector(L, f->code, f->sizecode, fs->pc, Instruction);
+  luaM_shrinkvector(L, f->templates, f->sizetemplates, fs->ntemplates,
+                       TableTemplate);
+  luaF_initcache(L, f);
   luaM_shrinkvector(L, f->lineinfo, f->sizelineinfo, fs->pc, ls_byte);
   luaM_shrinkvector(L, f->abslineinfo, f->sizeabslineinfo,
                        fs->nabslineinfo, AbsLineInfo);
@@ -1075,8 +1079,107 @@ typedef struct ConsControl {
   int nh;  /* total number of 'record' elements */
   int na;  /* number of array elements already stored */
   int tostore;  /* number of array elements pending to be stored */
+  int hastemplate;  /* true while the constructor can have a template *///构造式是否还可以使用模板
+  lu_byte tkeys[LUAI_MAXSHAPEKEYS];  /* constants with the record keys *///各字段键在常量表中的下标
+  short tvalues[LUAI_MAXSHAPEKEYS];  /* constants with their values, or -1 *///各字段常量值在常量表中的下标,非常量为-1
 } ConsControl;
 
+
+/*
+** Add to the template of a constructor the field just stored through
+** 'var' by 'recfield', whose value was coded from 'pc' on. A template
+** needs distinct constant short-string keys (OP_SETFIELD stores); the
+** value is a constant when the store was the only instruction coded
+** for it and had a constant operand.
+*/
+
+/// @brief 把recfield刚刚赋值的字段加入构造式的模板
+/// @param fs 
+/// @param cc 
+/// @param var 
+/// @param pc 
+static void templatefield (FuncState *fs, ConsControl *cc, expdesc *var,
+                           int pc) {
+  int n = cc->nh - 1;  /* position of this field */
+  Instruction inst = fs->f->code[fs->pc - 1];  /* its store */
+  int i;
+  if (!cc->hastemplate)
+    return;
+  if (var->k != VINDEXSTR || n >= LUAI_MAXSHAPEKEYS) {
+    cc->hastemplate = 0;
+    return;
+  }
+  for (i = 0; i < n; i++) {
+    if (cc->tkeys[i] == var->u.ind.idx) {  /* repeated key? */
+      cc->hastemplate = 0;
+      return;
+    }
+  }
+  cc->tkeys[n] = cast_byte(var->u.ind.idx);
+  if (fs->pc == pc + 1 && GET_OPCODE(inst) == OP_SETFIELD && TESTARG_k(inst))
+    cc->tvalues[n] = cast(short, GETARG_C(inst));
+  else
+    cc->tvalues[n] = -1;  /* value computed at run time */
+}
+
+
+/*
+** Give the constructor coded at 'pc' a template, when all its fields
+** could go into one and the shape of its tables is within the limits.
+** Its OP_NEWTABLE becomes an OP_NEWTEMPLATE, which copies the values
+** of the template into the new table; the stores of the constructor
+** then only change the fields computed at run time.
+*/
+
+/// @brief 为pc处的表构造式创建模板
+/// @param ls 
+/// @param cc 
+/// @param pc 
+static void maketemplate (LexState *ls, ConsControl *cc, int pc) {
+  lua_State *L = ls->L;
+  FuncState *fs = ls->fs;
+  Proto *f = fs->f;
+  TString *keys[LUAI_MAXSHAPEKEYS];
+  TableTemplate *tp;
+  Shape *s;
+  int n = cc->nh;
+  int i;
+  if (!cc->hastemplate || n == 0)
+    return;
+  for (i = 0; i < n; i++)
+    keys[i] = tsvalue(&f->k[cc->tkeys[i]]);
+  s = luaH_templateshape(L, keys, n);
+  if (s == NULL)  /* too many shapes? */
+    return;  /* keep the plain constructor */
+  if (fs->ntemplates >= f->sizetemplates) {
+    int oldsize = f->sizetemplates;
+    luaM_growvector(L, f->templates, fs->ntemplates, f->sizetemplates,
+                    TableTemplate, MAX_INT, "table templates");
+    while (oldsize < f->sizetemplates) {
+      f->templates[oldsize].shape = NULL;
+      f->templates[oldsize].values = NULL;
+      f->templates[oldsize++].nfields = 0;
+    }
+  }
+  tp = &f->templates[fs->ntemplates];
+  tp->values = luaM_newvector(L, n, TValue);
+  tp->nfields = n;
+  tp->shape = s;
+  tp->pc = pc;
+  tp->skip = 0;
+  for (i = 0; i < n; i++) {
+    if (cc->tvalues[i] >= 0) {
+      setobj(L, &tp->values[i], &f->k[cc->tvalues[i]]);
+      if (tp->skip == i)  /* all previous stores were constant too? */
+        tp->skip++;
+    }
+    else
+      setnilvalue(&tp->values[i]);
+  }
+  fs->ntemplates++;
+  SET_OPCODE(f->code[pc], OP_NEWTEMPLATE);
+}
+
 /// @brief 形如 local tbl = { x = y, [a] = b,} 中的x=1,这种指定tbl[k]=v的表达式
 /// @param ls 
 /// @param cc 
@@ -1085,6 +1188,7 @@ static void recfield (LexState *ls, ConsControl *cc) {
   FuncState *fs = ls->fs;
   int reg = ls->fs->freereg;
   expdesc tab, key, val;
+  int pc;
   if (ls->t.token == TK_NAME) {
     checklimit(fs, cc->nh, MAX_INT, "items in a constructor");
     codename(ls, &key);
@@ -1095,8 +1199,10 @@ static void recfield (LexState *ls, ConsControl *cc) {
   checknext(ls, '=');
   tab = *cc->t;
   luaK_indexed(fs, &tab, &key);
+  pc = fs->pc;
   expr(ls, &val);
   luaK_storevar(fs, &tab, &val);
+  templatefield(fs, cc, &tab, pc);
   fs->freereg = reg;  /* free registers */
 }
 
@@ -1140,6 +1246,7 @@ static void listfield (LexState *ls, ConsControl *cc) {
   /* listfield -> exp */
   expr(ls, &cc->v);
   cc->tostore++;
+  cc->hastemplate = 0;  /* templates are only for records */
 }
 
 /// @brief field -> listfield | recfield
@@ -1188,6 +1295,7 @@ static void constructor (LexState *ls, expdesc *t) {
   ConsControl cc;
   luaK_code(fs, 0);  /* space for extra arg. */
   cc.na = cc.nh = cc.tostore = 0;
+  cc.hastemplate = (LUAI_MAXSHAPES > 0);
   cc.t = t;
   init_exp(t, VNONRELOC, fs->freereg);  /* table will be at stack top */
   luaK_reserveregs(fs, 1);
@@ -1202,6 +1310,7 @@ static void constructor (LexState *ls, expdesc *t) {
   check_match(ls, '}', '{', line);
   lastlistfield(fs, &cc);
   luaK_settablesize(fs, pc, t->u.info, cc.na, cc.nh);
+  maketemplate(ls, &cc, pc);
 }
 
 /* }====================================================================== */
@@ -2073,7 +2182,8 @@ static void localfunc (LexState *ls) {
 static int getlocalattribute (LexState *ls) {
   /* ATTRIB -> ['<' Name '>'] */
   if (testnext(ls, '<')) {
-    const char *attr = getstr(str_checkname(ls));
+    TString *ts = str_checkname(ls);
+    const char *attr = getstr(ts);
     checknext(ls, '>');
     if (strcmp(attr, "const") == 0)
       return RDKCONST;  /* read-only variable *////只读变量
@@ -2344,6 +2454,7 @@ LClosure *luaY_parser (lua_State *L, ZIO *z, Mbuffer *buff,
   lexstate.h = luaH_new(L);  /* create table for scanner *///创建一个常量扫描表,用于加快查找效率
   sethvalue2s(L, L->top, lexstate.h);  /* anchor it *///挂到top避免被回收
   luaD_inctop(L);//自增top
+  luaH_resize(L, lexstate.h, 0, 1);  /* own hash part (never a shape) *///使用自己的hash部分,不使用shape
   funcstate.f = cl->p = luaF_newproto(L);//new一个函数原型
   luaC_objbarrier(L, cl, cl->p);
   funcstate.f->source = luaS_new(L, name);  /* create and anchor TString *///赋文件名字
@@ -192,6 +192,7 @@ typedef struct FuncState {
   int previousline;  /* last line that was saved in 'lineinfo' *///保存在行信息中的最后一行
   int nk;  /* number of elements in 'k' *///当前常量的数量
   int np;  /* number of elements in 'p' *///被编译的代码，Proto的数量
+  int ntemplates;  /* number of elements in 'templates' *///表构造模板数量
   int nabslineinfo;  /* number of elements in 'abslineinfo' *///绝对行信息
   int firstlocal;  /* index of first local var (in Dyndata array) */// 第一个local变量的位置
   int firstlabel;  /* index of first label (in 'dyd->label->arr') *///第一个label位置
@@ -289,6 +289,8 @@ static void close_state (lua_State *L) {
     luai_userstateclose(L);
   }
   luaM_freearray(L, G(L)->strt.hash, G(L)->strt.size);
+  luaM_freearray(L, G(L)->strt.oldhash, G(L)->strt.oldsize);
+  luaH_freeshapes(L);
   freestack(L);
   lua_assert(gettotalbytes(g) == sizeof(LG));
   (*g->frealloc)(g->ud, fromstate(L), sizeof(LG), 0);  /* free main block */
@@ -400,12 +402,22 @@ LUA_API lua_State *lua_newstate (lua_Alloc f, void *ud) {
   g->gcstp = GCSTPGC;  /* no GC while building state */
   g->strt.size = g->strt.nuse = 0;
   g->strt.hash = NULL;
+  g->strt.oldhash = NULL;
+  g->strt.oldsize = g->strt.nmoved = 0;
+  g->rootshape = g->deadshapes = NULL;
+  g->nshapes = 0;
+  g->idxversion = 0;
+  for (i = 0; i < INDEXCACHE_N; i++)
+    g->idxcache[i].mt = NULL;  /* no entry is valid */
   setnilvalue(&g->l_registry);
   g->panic = NULL;
+  g->nextf = NULL;
   g->gcstate = GCSpause;
   g->gckind = KGC_INC;
   g->gcstopem = 0;
   g->gcemergency = 0;
+  g->gcshrink = 0;
+  g->nshrink = 0;
   g->finobj = g->tobefnz = g->fixedgc = NULL;
   g->firstold1 = g->survival = g->old1 = g->reallyold = NULL;
   g->finobjsur = g->finobjold1 = g->finobjrold = NULL;
@@ -453,14 +465,18 @@ void luaE_warning (lua_State *L, const char *msg, int tocont) {
 */
 void luaE_warnerror (lua_State *L, const char *where) {
   TValue *errobj = s2v(L->top - 1);  /* error object */
-  const char *msg = (ttisstring(errobj))
-                  ? svalue(errobj)
-                  : "error object is not a string";
+  char *msg = (ttisstring(errobj))
+            ? svalue(errobj)
+            : cast_charp("error object is not a string");
+  size_t len = (ttisstring(errobj)) ? vslen(errobj) : strlen(msg);
+  char c;
+  luaS_closestr(msg, len, c);  /* message may be an open string */
   /* produce warning "error in %s (%s)" (where, msg) */
   luaE_warning(L, "error in ", 1);
   luaE_warning(L, where, 1);
   luaE_warning(L, " (", 1);
   luaE_warning(L, msg, 1);
   luaE_warning(L, ")", 0);
+  luaS_reopenstr(msg, len, c);
 }
 
@@ -168,9 +168,27 @@ typedef struct stringtable {
   TString **hash;//指向字符串的hash表
   int nuse;  /* number of elements *///元素个数
   int size;//hash table 大小 
+  TString **oldhash;  /* previous 'hash' while it is being emptied *///增量调整大小时的旧hash表,没有时为NULL
+  int oldsize;  /* size of 'oldhash' *///旧hash表大小
+  int nmoved;  /* number of buckets of 'oldhash' already moved *///旧hash表中已经搬走的桶数量
 } stringtable;
 
 
+/*
+** Entry of the cache of '__index' chains: looking up 'key' through the
+** '__index' chain that starts at metatable 'mt' found 'slot'. The entry
+** is valid only while 'version' matches 'idxversion' in the global
+** state.
+*/
+/// @brief __index链缓存的一项:从元表mt开始沿__index链查找key的结果为slot
+typedef struct IndexCache {
+  struct Table *mt;  /* metatable where the chain starts */
+  TString *key;
+  const TValue *slot;  /* where the value was found */
+  unsigned int version;
+} IndexCache;
+
+
 /*
 ** Information about a call.
 ** About union 'u':
@@ -274,6 +292,9 @@ typedef struct global_State {
   l_mem GCdebt;  /* bytes allocated not yet compensated by the collector *///需要回收的内存数量
   lu_mem GCestimate;  /* an estimate of the non-garbage memory in use *///上一轮完整GC 所存活下来的对象总数量内存值,小于 totalbytes
   lu_mem lastatomic;  /* see function 'genstep' in file 'lgc.c' *///原子扫描方式下的统计的垃圾量
+  struct Shape *rootshape;  /* root of the tree of table shapes *///表shape树的根(空布局)
+  struct Shape *deadshapes;  /* shapes to be freed after the sweep *///等待清扫结束后释放的shape
+  int nshapes;  /* number of shapes in that tree and in 'deadshapes' *///shape树和deadshapes中shape的数量
   stringtable strt;  /* hash table for strings *///全局的字符串哈希表，即保存那些短字符串，使得整个虚拟机中短字符串只有一份实例
   TValue l_registry;// //保存全局的注册表，注册表就是一个全局的table（即整个虚拟机中只有一个注册表），它只能被C代码访问，通常，它用来保存那些需要在几个模块中共享的数据。比如通过luaL_newmetatable创建的元表就是放在全局的注册表中
   TValue nilvalue;  /* a nil value *///一个空值
@@ -289,6 +310,9 @@ typedef struct global_State {
   lu_byte gcpause;  /* size of pause between successive GCs */// 用于控制下一轮GC开始的时机 控制垃圾收集器在一次收集完成后等待多久再开始新的一次收集
   lu_byte gcstepmul;  /* GC "speed" *////gc每步处理多少数据  控制GC的回收速度
   lu_byte gcstepsize;  /* (log2 of) GC granularity *///在下一个GC步骤之前这次GC回收内存对应的Tvalue量
+  lu_byte gcshrink;  /* true if the collector trims array parts *///为1时GC会释放表数组部分末尾的空槽位
+  int nshrink;  /* number of tables in 'shrinkq' */
+  Table *shrinkq[LUAI_SHRINKQ];  /* tables to be compacted (see 'checkSizes') *///本轮GC中等待压缩的表
   GCObject *allgc;  /* list of all collectable objects *///存放待GC对象的链表，所有对象创建之后都会放入该链表中
   GCObject **sweepgc;  /* current position of sweep in list */// 由于回收阶段不是一次性全部回收这个链表的所有数据，
                                                               // 所以使用这个变量来保存当前回收的位置，下一次从这个位置开始继续回收操作
@@ -316,12 +340,15 @@ typedef struct global_State {
   GCObject *finobjold1;  /* list of old1 objects with finalizers *///指向的是带有"__gc"元方法的old1对象
   GCObject *finobjrold;  /* list of really old objects with finalizers *////指向的是带有"__gc"元方法的被标记为G_OLD对象
   struct lua_State *twups;  /* list of threads with open upvalues *///twups 链表  所有带有 open upvalue 的 thread 都会放到这个链表中，这样提供了一个方便的遍历 thread 的途径，并且排除掉了没有 open upvalue 的 thread
+  lua_CFunction nextf;  /* 'next' function, traversed in place by generic 'for' *///通用for循环中VM直接遍历的next函数
   lua_CFunction panic;  /* to be called in unprotected errors *///代码出现错误且未被保护时，会调用panic函数并终止宿主程。这个函数可以通过lua_atpanic来修改
   struct lua_State *mainthread;//指向主lua_State，或者说是主线程、主执行栈
   TString *memerrmsg;  /* message for memory-allocation errors *///初始为 "not enough memory" 该字符串永远不会被回收
   TString *tmname[TM_N];  /* array with tag-method names *///初始化为元方法字符串, 在 ltm.c luaT_init 中, 且将它们标记为不可回收对象
   struct Table *mt[LUA_NUMTAGS];  /* metatables for basic types *////保存全局的注册表，注册表就是一个全局的table（即整个虚拟机中只有一个注册表），它只能被C代码访问，通常，它用来保存那些需要在几个模块中共享的数据。比如通过luaL_newmetatable创建的元表就是放在全局的注册表中
   TString *strcache[STRCACHE_N][STRCACHE_M];  /* cache for strings in API *///字符串缓存,这个缓存是用于提高字符串访问的命中率的
+  IndexCache idxcache[INDEXCACHE_N];  /* cache for '__index' chains *///__index链查找结果的缓存
+  unsigned int idxversion;  /* current version of 'idxcache' *///链缓存的版本号,链上任何表被修改时递增
   lua_WarnFunction warnf;  /* warning function *////警告函数
   void *ud_warn;         /* auxiliary data to 'warnf' */// warnf的辅助数据
 } global_State;
@@ -80,6 +80,8 @@ int luaS_eqlngstr (TString *a, TString *b) {
 /// @param l 待哈希的字符串长度（字符数）
 /// @param seed 哈希算法随机种子
 /// @return 
+#if !defined(LUAI_WORDHASH)
+
 unsigned int luaS_hash (const char *str, size_t l, unsigned int seed) {
   unsigned int h = seed ^ cast_uint(l);
   for (; l > 0; l--)
@@ -87,6 +89,96 @@ unsigned int luaS_hash (const char *str, size_t l, unsigned int seed) {
   return h;
 }
 
+#else
+
+/*
+** Word-at-a-time hash (see LUAI_WORDHASH). Strings up to 16 bytes are
+** read with at most four overlapping loads; longer ones are consumed
+** 16 bytes per step. Every product has the seed in both operands, so
+** that no input makes it vanish without knowledge of the seed. Bytes
+** are read in native order, so hashes are not portable across machines
+** (they are never saved).
+*/
+
+/* odd 64-bit constants (the secret of wyhash) */
+#define HASHK0	0xa0761d6478bd642fULL
+#define HASHK1	0xe7037ed1a0b428dbULL
+#define HASHK2	0x8ebc6af09c88c6e3ULL
+
+
+/// @brief 从p读取8个字节(本机字节序)
+static l_uint64 read64 (const char *p) {
+  l_uint64 v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+
+/// @brief 从p读取4个字节(本机字节序)
+static l_uint64 read32 (const char *p) {
+  l_uint32 v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+
+/*
+** Full 128-bit product of 'a' and 'b', folded back to 64 bits.
+*/
+
+/// @brief 计算a*b的128位乘积,高64位与低64位异或后返回
+static l_uint64 mix (l_uint64 a, l_uint64 b) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t r = (__uint128_t)a * b;
+  return (l_uint64)r ^ (l_uint64)(r >> 64);
+#else
+  l_uint64 ha = a >> 32, la = a & 0xffffffffu;
+  l_uint64 hb = b >> 32, lb = b & 0xffffffffu;
+  l_uint64 m0 = ha * lb, m1 = la * hb;
+  l_uint64 lo = la * lb;
+  l_uint64 t = lo + (m0 << 32);
+  l_uint64 hi = ha * hb + (m0 >> 32) + (m1 >> 32) + (t < lo);
+  lo = t + (m1 << 32);
+  hi += (lo < t);
+  return lo ^ hi;
+#endif
+}
+
+
+unsigned int luaS_hash (const char *str, size_t l, unsigned int seed) {
+  l_uint64 s = mix(seed ^ HASHK0, HASHK1);
+  l_uint64 a, b;
+  if (l <= 16) {
+    if (l >= 4) {
+      size_t d = (l >> 3) << 2;  /* 4 when 'l' >= 8 */
+      a = (read32(str) << 32) | read32(str + d);
+      b = (read32(str + l - 4) << 32) | read32(str + l - 4 - d);
+    }
+    else if (l > 0) {
+      a = (cast(l_uint64, cast_byte(str[0])) << 16) |
+          (cast(l_uint64, cast_byte(str[l >> 1])) << 8) |
+          cast_byte(str[l - 1]);
+      b = 0;
+    }
+    else
+      a = b = 0;
+  }
+  else {
+    size_t i = l;
+    do {
+      s = mix(read64(str) ^ s ^ HASHK1, read64(str + 8) ^ s ^ HASHK2);
+      str += 16;
+      i -= 16;
+    } while (i > 16);
+    a = read64(str + i - 16);  /* last 16 bytes (may overlap) */
+    b = read64(str + i - 8);
+  }
+  s = mix(a ^ s ^ HASHK1, b ^ s ^ HASHK2);
+  return cast_uint(mix(s ^ HASHK0 ^ l, HASHK1));
+}
+
+#endif
+
 /// @brief 如果长串没有计算过hash，则调用luaS_hashlongstr来计算
 /// @param ts 
 /// @return 
@@ -122,10 +214,47 @@ static void tablerehash (TString **vect, int osize, int nsize) {
 }
 
 
+/*
+** Move up to 'n' buckets of the old string table (see 'luaS_resize')
+** into the current one, freeing the old table when it becomes empty.
+*/
+
+/// @brief 把旧字符串表中最多n个桶搬到当前表中,旧表搬空后释放它
+/// @param L 
+/// @param n 
+void luaS_movebuckets (lua_State *L, int n) {
+  stringtable *tb = &G(L)->strt;
+  int i = tb->nmoved;
+  int lim = (tb->oldsize - i > n) ? i + n : tb->oldsize;
+  lua_assert(tb->oldhash != NULL);
+  for (; i < lim; i++) {
+    TString *p = tb->oldhash[i];
+    tb->oldhash[i] = NULL;
+    while (p) {  /* for each string in the bucket */
+      TString *hnext = p->u.hnext;  /* save next */
+      unsigned int h = lmod(p->hash, tb->size);  /* new position */
+      p->u.hnext = tb->hash[h];  /* chain it into current table */
+      tb->hash[h] = p;
+      p = hnext;
+    }
+  }
+  tb->nmoved = i;
+  if (i == tb->oldsize) {  /* old table is empty? */
+    luaM_freearray(L, tb->oldhash, tb->oldsize);
+    tb->oldhash = NULL;
+    tb->oldsize = tb->nmoved = 0;
+  }
+}
+
+
 /*
 ** Resize the string table. If allocation fails, keep the current size.
 ** (This can degrade performance, but any non-zero size should work
-** correctly.)
+** correctly.) When either size reaches LUAI_INCRHASH, the strings are
+** not moved at once: the current vector becomes 'oldhash', and its
+** buckets are moved into the new one by later string creations and
+** sweep steps (see 'luaS_movebuckets'). Meanwhile, lookups search
+** both tables.
 */
 
 /// @brief 该函数可以扩大或缩小hash表。扩大hash表时，则需要重新计算原有对象的hash值，调整原有元素的位置
@@ -133,8 +262,25 @@ static void tablerehash (TString **vect, int osize, int nsize) {
 /// @param nsize 新的空间大小
 void luaS_resize (lua_State *L, int nsize) {
   stringtable *tb = &G(L)->strt;
-  int osize = tb->size;
+  int osize;
   TString **newvect;
+  if (tb->oldhash != NULL)  /* still moving a previous resize? */
+    luaS_movebuckets(L, tb->oldsize);  /* finish it */
+  osize = tb->size;
+  if (osize >= LUAI_INCRHASH || nsize >= LUAI_INCRHASH) {  /* large? */
+    int i;
+    newvect = luaM_reallocvector(L, NULL, 0, nsize, TString*);
+    if (l_unlikely(newvect == NULL))  /* allocation failed? */
+      return;  /* leave table as it was */
+    for (i = 0; i < nsize; i++)
+      newvect[i] = NULL;
+    tb->oldhash = tb->hash;  /* move its strings incrementally */
+    tb->oldsize = osize;
+    tb->nmoved = 0;
+    tb->hash = newvect;
+    tb->size = nsize;
+    return;
+  }
   if (nsize < osize)  /* shrinking table? *///收缩表
     tablerehash(tb->hash, osize, nsize);  /* depopulate shrinking part */
   newvect = luaM_reallocvector(L, tb->hash, osize, nsize, TString*);//如果osize>=nsize缩小原来的内存块，如果nsize>osize重新分配一块新的内存并将原来的内存块内容copy到新的中
@@ -198,20 +344,18 @@ void luaS_init (lua_State *L) {
 
 /// @brief 创建一个字符串对象
 /// @param L 
-/// @param l 长度
+/// @param totalsize 对象的总大小
 /// @param tag LUA_VLNGSTR或者LUA_VSHRSTR类型
 /// @param h hash 值
 /// @return 
-static TString *createstrobj (lua_State *L, size_t l, int tag, unsigned int h) {
+static TString *createstrobj (lua_State *L, size_t totalsize, int tag,
+                              unsigned int h) {
   TString *ts;
   GCObject *o;
-  size_t totalsize;  /* total size of TString object */
-  totalsize = sizelstring(l);
   o = luaC_newobj(L, tag, totalsize);//创建字符串类型的GC对象 创建的GC对象会添加到g->allgc链表中
   ts = gco2ts(o);
   ts->hash = h;
   ts->extra = 0;
-  getstr(ts)[l] = '\0';  /* ending 0 */
   return ts;
 }
 
@@ -220,19 +364,264 @@ static TString *createstrobj (lua_State *L, size_t l, int tag, unsigned int h) {
 /// @param l 
 /// @return 
 TString *luaS_createlngstrobj (lua_State *L, size_t l) {
-  TString *ts = createstrobj(L, l, LUA_VLNGSTR, G(L)->seed);//这个createstrobj是直接创建一份malloc指定大小的内存空间
+  TString *ts = createstrobj(L, sizelngstr(l), LUA_VLNGSTR, G(L)->seed);//这个createstrobj是直接创建一份malloc指定大小的内存空间
+  ts->u.lnglen = l;
+  ts->shrlen = LSTRREG;
+  ts->contents = cast_charp(ts + 1);  /* content right after the header */
+  ts->contents[l] = '\0';  /* ending 0 */
+  return ts;
+}
+
+
+/*
+** {==================================================================
+** Shared string buffers
+** ===================================================================
+*/
+
+/*
+** A concatenation builds its result (a long string of kind 'LSTRBUF')
+** in a buffer allocated together with it, usually bigger than needed.
+** When the first operand of a later concatenation is the longest
+** string in such a buffer, the other operands are appended in place,
+** and the result is a new header sharing that buffer (its 'owner' is
+** the string holding the buffer). So, a loop like 's = s .. x' copies
+** each piece only once, instead of copying the whole accumulated
+** string at each step.
+**
+** All strings in a buffer start at its beginning. A string that is
+** not the longest one in its buffer has the bytes of a longer string
+** after it instead of its ending '\0'; it is "open". So are most
+** slices (see 'luaS_newsub'). Internal users of these bytes go by
+** their lengths; the few places that need a zero-terminated string
+** use 'luaS_seal' or 'luaS_isopen'.
+*/
+
+
+/*
+** Create a long string of length 'l' owning a buffer with 'size'
+** bytes.
+*/
+static TString *newbufstr (lua_State *L, size_t l, size_t size) {
+  TString *ts = createstrobj(L, sizebufstr(size), LUA_VLNGSTR, G(L)->seed);
+  StrBuf *sb = cast(StrBuf *, ts + 1);
+  sb->size = size;
+  sb->used = l;
+  sb->sealed = 0;
   ts->u.lnglen = l;
+  ts->shrlen = LSTRBUF;
+  ts->owner = ts;
+  ts->contents = cast_charp(sb + 1);
+  ts->contents[l] = '\0';  /* ending 0 */
+  return ts;
+}
+
+
+/*
+** Create the string of length 'l' for a concatenation whose first
+** operand is 'first'. If the bytes of 'first' are already in place,
+** sets '*inplace' to 1 and the caller only has to copy the other
+** operands after them; otherwise, the caller copies all operands.
+*/
+TString *luaS_newcat (lua_State *L, TString *first, size_t l, int *inplace) {
+  size_t size = l + 1;  /* exact size */
+  if (isbufstr(first)) {  /* 'first' resulted from a concatenation? */
+    TString *o = first->owner;
+    StrBuf *sb = strbuf(o);
+    if (!sb->sealed && first->u.lnglen == sb->used && l < sb->size) {
+      /* 'first' is the longest string in a buffer with enough room */
+      TString *ts = createstrobj(L, sizeof(TString), LUA_VLNGSTR,
+                                 G(L)->seed);
+      ts->u.lnglen = l;
+      ts->shrlen = LSTRBUF;
+      ts->owner = o;
+      ts->contents = getlngstr(o);
+      ts->contents[l] = '\0';  /* ending 0 */
+      sb->used = l;
+      *inplace = 1;
+      return ts;
+    }
+    /* else it is (probably) a chain; leave room for it to grow */
+    if (l <= (MAX_SIZE - sizebufstr(0)) / 2)
+      size = l * 2;
+  }
+  *inplace = 0;
+  return newbufstr(L, l, size);
+}
+
+
+/*
+** Give long string 'ts', whose content is held by another string, its
+** own zero-terminated copy of its bytes; 'ts' becomes a slice of that
+** copy.
+*/
+void luaS_unshare (lua_State *L, TString *ts) {
+  size_t l = ts->u.lnglen;
+  TString *copy = luaS_createlngstrobj(L, l);
+  lua_assert(ts->shrlen != LSTRREG && ts->owner != ts);
+  memcpy(getlngstr(copy), getlngstr(ts), l * sizeof(char));
+  ts->shrlen = LSTRSUB;
+  ts->owner = copy;
+  ts->contents = getlngstr(copy);
+  luaC_objbarrier(L, ts, copy);
+}
+
+
+/*
+** Ensure that long string 'ts' keeps a '\0' after its bytes. If it
+** ends where its buffer is filled (it is the longest string there, or
+** a slice ending with it), the buffer stops growing in place; if it is
+** open, it gets its own copy of its bytes or, when it owns its buffer,
+** returns a zero-terminated copy of it, which the caller must put in
+** the place of 'ts'.
+*/
+TString *luaS_seal (lua_State *L, TString *ts) {
+  if (ts->tt == LUA_VLNGSTR) {
+    TString *o = strholder(ts);
+    if (o->shrlen == LSTRBUF &&
+        getlngstr(ts) + ts->u.lnglen == getlngstr(o) + strbuf(o)->used)
+      strbuf(o)->sealed = 1;  /* its '\0' is the one of the buffer */
+    else if (luaS_isopen(ts)) {
+      if (ts->owner != ts)  /* content held by another string? */
+        luaS_unshare(L, ts);
+      else  /* its buffer holds longer strings */
+        return luaS_newlstr(L, getlngstr(ts), ts->u.lnglen);
+    }
+  }
   return ts;
 }
 
+
+/*
+** Create the substring of 'ts' with 'l' bytes starting at offset 'i'.
+** A long enough substring is a slice (a string of kind 'LSTRSUB') that
+** references the bytes of 'ts', unless it would keep alive a memory
+** block much bigger than itself. Slices are usually open. There are no
+** slices of external strings, as the temporary '\0' given to open
+** strings (see 'luaS_closestr') cannot go into memory not owned by Lua.
+*/
+TString *luaS_newsub (lua_State *L, TString *ts, size_t i, size_t l) {
+  const char *s = getstr(ts) + i;
+  lua_assert(i + l <= tsslen(ts));
+  if (l == tsslen(ts))  /* whole string? */
+    return ts;
+  else if (l <= LUAI_MAXSHORTLEN || l < LUAI_MINSUBSTR ||
+           l < luaS_sizelngstr(strholder(ts)) / LUAI_SUBRATIO ||
+           strholder(ts)->shrlen == LSTREXT)
+    return luaS_newlstr(L, s, l);  /* copy it */
+  else {
+    TString *o = strholder(ts);
+    TString *sub = createstrobj(L, sizeof(TString), LUA_VLNGSTR,
+                                G(L)->seed);
+    sub->u.lnglen = l;
+    sub->shrlen = LSTRSUB;
+    sub->owner = o;
+    sub->contents = cast_charp(s);
+    return sub;
+  }
+}
+
+
+/*
+** Size of the memory block of long string 'ts'
+*/
+size_t luaS_sizelngstr (TString *ts) {
+  switch (ts->shrlen) {
+    case LSTRREG: return sizelngstr(ts->u.lnglen);
+    case LSTRBUF:
+      return (ts->owner == ts) ? sizebufstr(strbuf(ts)->size)
+                               : sizeof(TString);  /* only the header */
+    case LSTRSUB: return sizeof(TString);  /* only the header */
+    default: lua_assert(ts->shrlen == LSTREXT); return sizeextstr;
+  }
+}
+
+
+/*
+** Free long string 'ts', releasing the content of an external string
+*/
+void luaS_freelngstr (lua_State *L, TString *ts) {
+  if (ts->shrlen == LSTREXT) {
+    ExtStr *es = extstr(ts);
+    if (es->falloc != NULL)
+      (*es->falloc)(es->ud, getlngstr(ts), ts->u.lnglen + 1, 0);
+  }
+  luaM_freemem(L, ts, luaS_sizelngstr(ts));
+}
+
+
+/* data for 'f_newext' */
+struct SExtStr {
+  const char *s;
+  size_t l;
+  TString *ts;  /* result */
+};
+
+
+/*
+** Create the string for 'luaS_newextlstr': a copy for short strings,
+** or the object of an external string.
+*/
+static void f_newext (lua_State *L, void *ud) {
+  struct SExtStr *e = cast(struct SExtStr *, ud);
+  if (e->l <= LUAI_MAXSHORTLEN)  /* short string? */
+    e->ts = luaS_newlstr(L, e->s, e->l);  /* must be internalized */
+  else
+    e->ts = createstrobj(L, sizeextstr, LUA_VLNGSTR, G(L)->seed);
+}
+
+
+/*
+** Create a string with the 'l' bytes in 's', which must be followed by
+** a '\0', without copying them; 'falloc' (if not NULL) releases them
+** when the string is collected, as in 'falloc(ud, s, l + 1, 0)'. A
+** short string must be internalized, so it gets a copy and 's' is
+** released right away. 's' always belongs to Lua after this call: if
+** creating the string raises an error, 's' is released before the
+** error propagates.
+*/
+TString *luaS_newextlstr (lua_State *L, const char *s, size_t l,
+                          lua_Alloc falloc, void *ud) {
+  struct SExtStr e;
+  int status;
+  e.s = s; e.l = l; e.ts = NULL;
+  status = luaD_rawrunprotected(L, f_newext, &e);
+  if (status != LUA_OK || l <= LUAI_MAXSHORTLEN) {  /* 's' not kept? */
+    if (falloc != NULL)
+      (*falloc)(ud, cast_voidp(s), l + 1, 0);  /* no longer needed */
+    if (status != LUA_OK)
+      luaD_throw(L, status);  /* re-raise the error */
+  }
+  else {
+    TString *ts = e.ts;
+    ExtStr *es;
+    ts->u.lnglen = l;
+    ts->shrlen = LSTREXT;
+    ts->owner = ts;
+    ts->contents = cast_charp(s);
+    es = extstr(ts);
+    es->falloc = falloc;
+    es->ud = ud;
+  }
+  return e.ts;
+}
+
+/* }================================================================== */
+
 /// @brief 将指定的短字符串从字符串表里移除
 /// @param L 
 /// @param ts 
 void luaS_remove (lua_State *L, TString *ts) {
   stringtable *tb = &G(L)->strt;
   TString **p = &tb->hash[lmod(ts->hash, tb->size)];
-  while (*p != ts)  /* find previous element *///从桶链表中查找指定的字符串
-    p = &(*p)->u.hnext;
+  while (*p != ts) {  /* find previous element *///从桶链表中查找指定的字符串
+    if (*p == NULL) {  /* not in current table? */
+      lua_assert(tb->oldhash != NULL);
+      p = &tb->oldhash[lmod(ts->hash, tb->oldsize)];  /* must be in old one */
+    }
+    else
+      p = &(*p)->u.hnext;
+  }
   *p = (*p)->u.hnext;  /* remove element from its list *///从桶链表中移除
   tb->nuse--;
 }
@@ -251,6 +640,30 @@ static void growstrtab (lua_State *L, stringtable *tb) {
 }
 
 
+/*
+** Search the list of strings 'ts' for the short string 'str'.
+*/
+
+/// @brief 在桶链表ts中查找短字符串str,找不到返回NULL
+/// @param g 
+/// @param ts 
+/// @param str 
+/// @param l 
+/// @return 
+static TString *findshrstr (global_State *g, TString *ts, const char *str,
+                            size_t l) {
+  for (; ts != NULL; ts = ts->u.hnext) {//进行遍历查找
+    if (l == ts->shrlen && (memcmp(str, getstr(ts), l * sizeof(char)) == 0)) {//如果找到了
+      /* found! */
+      if (isdead(g, ts))  /* dead (but not collected yet)? *///如果是死亡状态，但是还没有回收
+        changewhite(ts);  /* resurrect it *///复活他
+      return ts;
+    }
+  }
+  return NULL;
+}
+
+
 /*
 ** Checks whether short string exists and reuses it or creates a new one.
 */
@@ -265,23 +678,22 @@ static TString *internshrstr (lua_State *L, const char *str, size_t l) {
   global_State *g = G(L);
   stringtable *tb = &g->strt;
   unsigned int h = luaS_hash(str, l, g->seed);//得到一个hash值
-  TString **list = &tb->hash[lmod(h, tb->size)];//用hash得到的模,得到hash桶链表
+  TString **list;
   lua_assert(str != NULL);  /* otherwise 'memcmp'/'memcpy' are undefined *///不能是空
-  for (ts = *list; ts != NULL; ts = ts->u.hnext) {//进行遍历查找
-    if (l == ts->shrlen && (memcmp(str, getstr(ts), l * sizeof(char)) == 0)) {//如果找到了
-      /* found! */
-      if (isdead(g, ts))  /* dead (but not collected yet)? *///如果是死亡状态，但是还没有回收
-        changewhite(ts);  /* resurrect it *///复活他
-      return ts;
-    }
-  }
+  ts = findshrstr(g, tb->hash[lmod(h, tb->size)], str, l);
+  if (ts == NULL && tb->oldhash != NULL)  /* table being resized? */
+    ts = findshrstr(g, tb->oldhash[lmod(h, tb->oldsize)], str, l);
+  if (ts != NULL)
+    return ts;
   /* else must create a new string *///否则必须创建一个新字符串
-  if (tb->nuse >= tb->size) {  /* need to grow string table? *///需要扩容
+  if (tb->oldhash != NULL)  /* table being resized? */
+    luaS_movebuckets(L, LUAI_HASHSTEP);  /* move a few more buckets */
+  if (tb->nuse >= tb->size)  /* need to grow string table? *///需要扩容
     growstrtab(L, tb);//扩容
-    list = &tb->hash[lmod(h, tb->size)];  /* rehash with new size *///用新尺寸重新散列
-  }
-  ts = createstrobj(L, l, LUA_VSHRSTR, h);//创建一个短字符串
-  memcpy(getstr(ts), str, l * sizeof(char));//进行拷贝
+  list = &tb->hash[lmod(h, tb->size)];//用hash得到的模,得到hash桶链表
+  ts = createstrobj(L, sizelstring(l), LUA_VSHRSTR, h);//创建一个短字符串
+  memcpy(getshrstr(ts), str, l * sizeof(char));//进行拷贝
+  getshrstr(ts)[l] = '\0';  /* ending 0 */
   ts->shrlen = cast_byte(l);//设置大小
   ts->u.hnext = *list;//进行链接
   *list = ts;//指向新串
@@ -307,7 +719,7 @@ TString *luaS_newlstr (lua_State *L, const char *str, size_t l) {
     if (l_unlikely(l >= (MAX_SIZE - sizeof(TString))/sizeof(char)))//检测一下字符串是不是太大
       luaM_toobig(L);//报错
     ts = luaS_createlngstrobj(L, l);//创建长字符串
-    memcpy(getstr(ts), str, l * sizeof(char));//进行拷贝
+    memcpy(getlngstr(ts), str, l * sizeof(char));//进行拷贝
     return ts;
   }
 }
@@ -360,6 +772,7 @@ Udata *luaS_newudata (lua_State *L, size_t s, int nuvalue) {
   u = gco2u(o);//转换
   u->len = s;//设置长度
   u->nuvalue = nuvalue;//设置上值个数
+  u->atype = 0;  /* not a typed array */
   u->metatable = NULL;//元方法初始化
   for (i = 0; i < nuvalue; i++)//初始化上值value
     setnilvalue(&u->uv[i].uv);
@@ -45,6 +45,65 @@
 // + 1 是因为屁股后面要添加一个'\0'
 #define sizelstring(l)  (offsetof(TString, contents) + ((l) + 1) * sizeof(char))
 
+/*
+** Size of a long string with its content right after the header
+*/
+#define sizelngstr(l)	(sizeof(TString) + ((l) + 1) * sizeof(char))
+
+
+/*
+** Header of the buffer of a long string of kind 'LSTRBUF' that owns
+** it (its 'owner' is itself); the buffer follows this header.
+*/
+typedef struct StrBuf {
+  size_t size;  /* size of the buffer */
+  size_t used;  /* length of the longest string in it */
+  lu_byte sealed;  /* true if its longest string cannot grow in place */
+} StrBuf;
+
+/* size of a long string owning a buffer with 'n' bytes */
+#define sizebufstr(n)	(sizeof(TString) + sizeof(StrBuf) + (n))
+
+/* buffer header of string 'o', which must own it */
+#define strbuf(o)	check_exp((o)->owner == (o), cast(StrBuf *, (o) + 1))
+
+/* test whether a string has its content in a shared buffer */
+#define isbufstr(ts)	((ts)->tt == LUA_VLNGSTR && (ts)->shrlen == LSTRBUF)
+
+/*
+** Header of an external string ('LSTREXT'), after the TString: the
+** function to release its content, if any
+*/
+typedef struct ExtStr {
+  lua_Alloc falloc;
+  void *ud;
+} ExtStr;
+
+/* size of an external string */
+#define sizeextstr	(sizeof(TString) + sizeof(ExtStr))
+
+#define extstr(ts)	check_exp((ts)->shrlen == LSTREXT, cast(ExtStr *, (ts) + 1))
+
+/* test whether a string is a slice of another one */
+#define issubstr(ts)	((ts)->tt == LUA_VLNGSTR && (ts)->shrlen == LSTRSUB)
+
+/* string whose memory block holds the content of long string 'ts' */
+#define strholder(ts)	((ts)->shrlen == LSTRREG ? (ts) : (ts)->owner)
+
+/* test whether the bytes of a string are not followed by a '\0' */
+#define luaS_isopen(ts)	(getstr(ts)[tsslen(ts)] != '\0')
+
+/*
+** Give the bytes 's' (with length 'l') of a string that may be open a
+** temporary '\0', saving in 'c' the byte it replaces; for places that
+** need a C string but cannot allocate a copy. 'luaS_reopenstr' puts
+** the byte back.
+*/
+#define luaS_closestr(s,l,c)  \
+	{ c = (s)[l]; if (c != '\0') (s)[l] = '\0'; }
+#define luaS_reopenstr(s,l,c)	{ if (c != '\0') (s)[l] = c; }
+
+
 ///目前来看是创建系统保留字的接口
 #define luaS_newliteral(L, s)	(luaS_newlstr(L, "" s, \
                                  (sizeof(s)/sizeof(char))-1))
@@ -70,6 +129,7 @@ LUAI_FUNC unsigned int luaS_hash (const char *str, size_t l, unsigned int seed);
 LUAI_FUNC unsigned int luaS_hashlongstr (TString *ts);
 LUAI_FUNC int luaS_eqlngstr (TString *a, TString *b);
 LUAI_FUNC void luaS_resize (lua_State *L, int newsize);
+LUAI_FUNC void luaS_movebuckets (lua_State *L, int n);
 LUAI_FUNC void luaS_clearcache (global_State *g);
 LUAI_FUNC void luaS_init (lua_State *L);
 LUAI_FUNC void luaS_remove (lua_State *L, TString *ts);
@@ -77,6 +137,16 @@ LUAI_FUNC Udata *luaS_newudata (lua_State *L, size_t s, int nuvalue);
 LUAI_FUNC TString *luaS_newlstr (lua_State *L, const char *str, size_t l);
 LUAI_FUNC TString *luaS_new (lua_State *L, const char *str);
 LUAI_FUNC TString *luaS_createlngstrobj (lua_State *L, size_t l);
+LUAI_FUNC TString *luaS_newcat (lua_State *L, TString *first, size_t l,
+                                int *inplace);
+LUAI_FUNC TString *luaS_seal (lua_State *L, TString *ts);
+LUAI_FUNC TString *luaS_newsub (lua_State *L, TString *ts, size_t i,
+                                size_t l);
+LUAI_FUNC void luaS_unshare (lua_State *L, TString *ts);
+LUAI_FUNC size_t luaS_sizelngstr (TString *ts);
+LUAI_FUNC void luaS_freelngstr (lua_State *L, TString *ts);
+LUAI_FUNC TString *luaS_newextlstr (lua_State *L, const char *s, size_t l,
+                                    lua_Alloc falloc, void *ud);
 
 
 #endif
@@ -104,12 +104,15 @@ static size_t getendpos (lua_State *L, int arg, lua_Integer def,
 
 
 static int str_sub (lua_State *L) {
-  size_t l;
-  const char *s = luaL_checklstring(L, 1, &l);
-  size_t start = posrelatI(luaL_checkinteger(L, 2), l);
-  size_t end = getendpos(L, 3, -1, l);
+  size_t l, start, end;
+  if (lua_type(L, 1) == LUA_TSTRING)  /* no need for a pointer? */
+    l = lua_rawlen(L, 1);  /* (a slice would need a zero-terminated copy) */
+  else
+    luaL_checklstring(L, 1, &l);  /* convert number or raise an error */
+  start = posrelatI(luaL_checkinteger(L, 2), l);
+  end = getendpos(L, 3, -1, l);
   if (start <= end)
-    lua_pushlstring(L, s + start - 1, (end - start) + 1);
+    lua_pushsubstring(L, 1, start - 1, (end - start) + 1);
   else lua_pushliteral(L, "");
   return 1;
 }
@@ -366,6 +369,7 @@ typedef struct MatchState {
   const char *src_end;  /* end ('\0') of source string */
   const char *p_end;  /* end ('\0') of pattern */
   lua_State *L;
+  int srcidx;  /* index of source string */
   int matchdepth;  /* control for recursive depth (to avoid C stack overflow) */
   unsigned char level;  /* total number of captures (finished or unfinished) */
   struct {
@@ -733,7 +737,7 @@ static void push_onecapture (MatchState *ms, int i, const char *s,
   const char *cap;
   ptrdiff_t l = get_onecapture(ms, i, s, e, &cap);
   if (l != CAP_POSITION)
-    lua_pushlstring(ms->L, cap, l);
+    lua_pushsubstring(ms->L, ms->srcidx, cap - ms->src_init, l);
   /* else position was already pushed */
 }
 
@@ -760,9 +764,10 @@ static int nospecials (const char *p, size_t l) {
 }
 
 
-static void prepstate (MatchState *ms, lua_State *L,
+static void prepstate (MatchState *ms, lua_State *L, int srcidx,
                        const char *s, size_t ls, const char *p, size_t lp) {
   ms->L = L;
+  ms->srcidx = srcidx;
   ms->matchdepth = MAXCCALLS;
   ms->src_init = s;
   ms->src_end = s + ls;
@@ -802,7 +807,7 @@ static int str_find_aux (lua_State *L, int find) {
     if (anchor) {
       p++; lp--;  /* skip anchor character */
     }
-    prepstate(&ms, L, s, ls, p, lp);
+    prepstate(&ms, L, 1, s, ls, p, lp);
     do {
       const char *res;
       reprepstate(&ms);
@@ -867,7 +872,7 @@ static int gmatch (lua_State *L) {
   gm = (GMatchState *)lua_newuserdatauv(L, sizeof(GMatchState), 0);
   if (init > ls)  /* start after string's end? */
     init = ls + 1;  /* avoid overflows in 's + init' */
-  prepstate(&gm->ms, L, s, ls, p, lp);
+  prepstate(&gm->ms, L, lua_upvalueindex(1), s, ls, p, lp);
   gm->src = s + init; gm->p = p; gm->lastmatch = NULL;
   lua_pushcclosure(L, gmatch_aux, 3);
   return 1;
@@ -964,7 +969,7 @@ static int str_gsub (lua_State *L) {
   if (anchor) {
     p++; lp--;  /* skip anchor character */
   }
-  prepstate(&ms, L, src, srcl, p, lp);
+  prepstate(&ms, L, 1, src, srcl, p, lp);
   while (n < max_s) {
     const char *e;
     reprepstate(&ms);  /* (re)prepare state for new match */
@@ -1802,13 +1807,13 @@ static int str_unpack (lua_State *L) {
         break;
       }
       case Kchar: {
-        lua_pushlstring(L, data + pos, size);
+        lua_pushsubstring(L, 2, pos, size);
         break;
       }
       case Kstring: {
         size_t len = (size_t)unpackint(L, data + pos, h.islittle, size, 0);
         luaL_argcheck(L, len <= ld - pos - size, 2, "data string too short");
-        lua_pushlstring(L, data + pos + size, len);
+        lua_pushsubstring(L, 2, pos + size, len);
         pos += len;  /* skip string */
         break;
       }
@@ -1816,7 +1821,7 @@ static int str_unpack (lua_State *L) {
         size_t len = strlen(data + pos);
         luaL_argcheck(L, pos + len < ld, 2,
                          "unfinished string for format 'z'");
-        lua_pushlstring(L, data + pos, len);
+        lua_pushsubstring(L, 2, pos, len);
         pos += len + 1;  /* skip string plus final '\0' */
         break;
       }
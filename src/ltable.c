@@ -22,15 +22,24 @@
 ** Non-negative integer keys are all candidates to be kept in the array
 ** part. The actual size of the array is the largest 'n' such that
 ** more than half the slots between 1 and n are in use.
-** Hash uses a mix of chained scatter table with Brent's variation.
-** A main invariant of these tables is that, if an element is not
-** in its main position (i.e. the 'original' position that its hash gives
-** to it), then the colliding element is in its own main position.
-** Hence even when the load factor reaches 100%, performance remains good.
+** Hash uses open addressing with linear probing, in groups of nodes.
+** Besides the nodes, the hash part keeps one control byte per node:
+** either CTRL_EMPTY (the node was never used since the last rehash) or
+** a 7-bit tag computed from the key's hash. A search compares the tag
+** against a whole group of control bytes at once (with SSE2, when
+** available) and only looks at the nodes whose tag matches; it stops
+** at the first group with an empty node. Removed entries keep their
+** keys (as before) and act as tombstones until the next rehash. The
+** load factor is kept below 7/8 for tables larger than a group.
+** A large hash part that fills up is not rehashed at once: the table
+** gets a new hash part twice as large, and the old one is kept in
+** 'oldhash' until later insertions and the collector have moved all its
+** entries (see 'movehash'). Meanwhile, searches look into both parts.
 */
 
 #include <math.h>
 #include <limits.h>
+#include <string.h>
 
 #include "lua.h"
 
@@ -77,12 +86,138 @@
 
 /*
 ** MAXHSIZE is the maximum size of the hash part. It is the minimum
-** between 2^MAXHBITS and the maximum size such that, measured in bytes,
-** it fits in a 'size_t'.
+** between 2^MAXHBITS and the maximum size such that, measured in bytes
+** (including the control bytes), it fits in a 'size_t'.
 */
 
 //hash部分最大size
-#define MAXHSIZE	luaM_limitN(1u << MAXHBITS, Node)
+#define MAXHSIZE	\
+	((cast_sizet(1u << MAXHBITS) <= MAXHNODES) \
+	  ? (1u << MAXHBITS) : cast_uint(MAXHNODES))
+
+/* maximum number of nodes (plus their control bytes) that fit a size_t */
+#define MAXHNODES	((MAX_SIZET - GROUPSIZE) / (sizeof(Node) + 1))
+
+
+/*
+** {=============================================================
+** Control bytes
+** ==============================================================
+*/
+
+/*
+** The control bytes of a hash part of size 'n' follow its nodes in
+** the same block. There are 'n + GROUPSIZE' of them: the last
+** GROUPSIZE bytes repeat the first ones (cyclically, for tables
+** smaller than a group), so that a group starting at any position can
+** be read without wrapping around.
+*/
+#define ctrlbytes(t)	cast(lu_byte *, gnode(t, sizenode(t)))
+
+/* size of the block for a hash part with 'n' nodes */
+#define sizehashpart(n)	(cast_sizet(n) * (sizeof(Node) + 1) + GROUPSIZE)
+
+/* control byte for a node that was never used */
+#define CTRL_EMPTY	0x80
+
+/* tag of a key with hash 'h' (7 bits, so never equal to CTRL_EMPTY) */
+#define ctrltag(h)	cast_byte(((cast_uint(h) * 2654435761u) >> 25) & 0x7fu)
+
+/*
+** Maximum number of keys a hash part of size 'n' can take before a
+** rehash. A table that fits in one group may be full, as a search
+** reads it whole anyway.
+*/
+#define hashcapacity(n)	((n) <= GROUPSIZE ? (n) : (n) - (n) / 8)
+
+
+#if defined(__SSE2__) && !defined(LUAI_NOSIMD)
+
+#include <emmintrin.h>
+
+#define GROUPSIZE	16
+
+/* bit mask of the bytes in the group at 'p' equal to 'c' */
+#define groupmatch(p,c) \
+	cast_uint(_mm_movemask_epi8(_mm_cmpeq_epi8( \
+	  _mm_loadu_si128(cast(const __m128i *, (p))), \
+	  _mm_set1_epi8(cast(char, (c))))))
+
+/* bit mask of the empty nodes in the group at 'p' (only they have bit 7) */
+#define groupempty(p) \
+	cast_uint(_mm_movemask_epi8(_mm_loadu_si128(cast(const __m128i *, (p)))))
+
+#else
+
+#define GROUPSIZE	8
+
+static unsigned int groupmatch (const lu_byte *p, int c) {
+  unsigned int m = 0;
+  int i;
+  for (i = 0; i < GROUPSIZE; i++)
+    m |= cast_uint(p[i] == c) << i;
+  return m;
+}
+
+#define groupempty(p)	groupmatch(p, CTRL_EMPTY)
+
+#endif
+
+
+/* index of the lowest bit set in 'm' (not zero) */
+#if defined(__GNUC__)
+#define lowbit(m)	__builtin_ctz(m)
+#else
+static int lowbit (unsigned int m) {
+  int i = 0;
+  while (!(m & 1u)) { m >>= 1; i++; }
+  return i;
+}
+#endif
+
+
+/*
+** Set the control byte of node 'i' and of its copies at the end.
+*/
+
+/// @brief 设置第i个节点的控制字节(以及它在末尾的副本)
+/// @param t
+/// @param i
+/// @param c
+static void setctrl (Table *t, unsigned int i, lu_byte c) {
+  lu_byte *ctrl = ctrlbytes(t);
+  unsigned int size = sizenode(t);
+  ctrl[i] = c;
+  for (; i < GROUPSIZE; i += size)
+    ctrl[size + i] = c;
+}
+
+
+/*
+** Search for a key in the hash part of 't', starting at its main
+** position 'i' and comparing with 'eq' the nodes whose control byte
+** matches 'tag'. A table small enough to fit in one group may have no
+** empty node, so the search also stops after reading all nodes.
+** When the key is not there, execution goes on after the macro.
+*/
+#define searchnode(t,i,tag,eq) \
+	{ const lu_byte *ctrl_ = ctrlbytes(t); \
+	  unsigned int mask_ = sizenode(t) - 1; \
+	  unsigned int left_ = sizenode(t); \
+	  for (;;) { \
+	    unsigned int m_ = groupmatch(ctrl_ + (i), (tag)); \
+	    while (m_ != 0) { \
+	      Node *n = gnode(t, ((i) + lowbit(m_)) & mask_); \
+	      if (eq) return gval(n); \
+	      m_ &= m_ - 1; \
+	    } \
+	    if (groupempty(ctrl_ + (i)) != 0 || left_ <= GROUPSIZE) \
+	      break;  /* not found */ \
+	    left_ -= GROUPSIZE; \
+	    (i) = ((i) + GROUPSIZE) & mask_; \
+	  } }
+
+/* }============================================================= */
 
 
 /*
@@ -90,8 +225,8 @@
 ** avoids the cost of '%'.
 */
 
-//根据n的值，对其t进行lmod操作
-#define hashpow2(t,n)		(gnode(t, lmod((n), sizenode(t))))
+//根据n的值，对其t进行lmod操作,得到节点下标
+#define hashpow2(t,n)		lmod((n), sizenode(t))
 
 /*
 ** for other types, it is better to avoid modulo by power of 2, as
@@ -99,8 +234,8 @@
 */
 
 //对lsizenode2次幂减1取模（最后按位或1，是为了保持要用来取模的数字((sizenode(t)-1)|1)这段保证不为0，是大于等于1的数）
-//返回值是 0 ~ (size - 1) 下标下的hash值
-#define hashmod(t,n)	(gnode(t, ((n) % ((sizenode(t)-1)|1))))
+//返回值是 0 ~ (size - 1) 的节点下标
+#define hashmod(t,n)	cast_uint((n) % ((sizenode(t)-1)|1))
 
 //字符串hash
 #define hashstr(t,str)		hashpow2(t, (str)->hash)
@@ -111,15 +246,37 @@
 #define hashpointer(t,p)	hashmod(t, point2uint(p))
 
 
+/*
+** The dummy node, used by all empty hash parts, followed by its control
+** bytes (all empty).
+*/
 // 宏定义一个虚拟节点，用于空哈希部分的元素
-#define dummynode		(&dummynode_)
-
-static const Node dummynode_ = {
-  {{NULL}, LUA_VEMPTY,  /* value's value and type */
-   LUA_VNIL, 0, {NULL}}  /* key type, next, and key value */
+#define dummynode		(&dummy_.n)
+
+#define CE	CTRL_EMPTY
+
+static const struct {
+  Node n;
+  lu_byte ctrl[1 + GROUPSIZE];
+} dummy_ = {
+  {{{NULL}, LUA_VEMPTY,  /* value's value and type */
+    LUA_VNIL, 0, {NULL}}},  /* key type, moved flag, and key value */
+  {CE, CE, CE, CE, CE, CE, CE, CE, CE
+#if GROUPSIZE > 8
+   , CE, CE, CE, CE, CE, CE, CE, CE
+#endif
+  }
 };
 
-//通过next顺着hash冲突链查找。如果找到就范围对应TValue，找不到返回TValue常量absentkey
+#undef CE
+
+
+#if defined(LUAI_ICSTATS)
+LUAI_DDEF lu_mem luaH_icprobes = 0;
+LUAI_DDEF lu_mem luaH_icmisses = 0;
+#endif
+
+//在散列表中查找。如果找到就返回对应TValue，找不到返回TValue常量absentkey
 static const TValue absentkey = {ABSTKEYCONSTANT};
 
 
@@ -145,7 +302,7 @@ static const TValue absentkey = {ABSTKEYCONSTANT};
 /// @param t 
 /// @param i key
 /// @return 
-static Node *hashint (const Table *t, lua_Integer i) {
+static unsigned int hashint (const Table *t, lua_Integer i) {
   lua_Unsigned ui = l_castS2U(i);//如果要对负数计算哈希值的话，先转成正数方便计算
   if (ui <= (unsigned int)INT_MAX)//没有超过无符号int最大值 (unsigned int)INT_MAX = 2147483647
     return hashmod(t, cast_int(ui));
@@ -213,60 +370,61 @@ static int l_hashfloat (lua_Number n) {
 
 /*
 ** returns the 'main' position of an element in a table (that is,
-** the index of its hash value).
+** the index of its hash value), and its control tag in '*tag'.
 */
 
-/// @brief mainposition函数通过key找到主位置的node
+/// @brief mainposition函数通过key找到主位置的节点下标,并通过tag返回key的控制字节
 /// @param t 
 /// @param key 
+/// @param tag 
 /// @return 
-static Node *mainpositionTV (const Table *t, const TValue *key) {
+static unsigned int mainpositionTV (const Table *t, const TValue *key,
+                                    lu_byte *tag) {
   switch (ttypetag(key)) {
     case LUA_VNUMINT: {//key为整数类型
       lua_Integer i = ivalue(key);
-      return hashint(t, i);//返回对应整数值对散列表大小取余的key对应的节点
+      *tag = ctrltag(l_castS2U(i));
+      return hashint(t, i);//返回对应整数值对散列表大小取余的下标
     }
     case LUA_VNUMFLT: {//key为浮点类型
-      lua_Number n = fltvalue(key);
-      return hashmod(t, l_hashfloat(n));//返回值是 0 ~ (size - 1) 下标下的hash node
+      int h = l_hashfloat(fltvalue(key));
+      *tag = ctrltag(h);
+      return hashmod(t, h);//返回值是 0 ~ (size - 1) 的下标
     }
     case LUA_VSHRSTR: {//key为短字符串类型
       TString *ts = tsvalue(key);
+      *tag = ctrltag(ts->hash);
       return hashstr(t, ts);//字符串对应的hash
     }
     case LUA_VLNGSTR: {//key为长字符串类型
-      TString *ts = tsvalue(key);
-      return hashpow2(t, luaS_hashlongstr(ts));//如果长串没有计算过hash，则调用luaS_hashlongstr来计算，然后再使用hash & (2^t->lsizenode - 1)来获取hash node
+      unsigned int h = luaS_hashlongstr(tsvalue(key));//如果长串没有计算过hash，则调用luaS_hashlongstr来计算
+      *tag = ctrltag(h);
+      return hashpow2(t, h);
     }
     case LUA_VFALSE://bool false
+      *tag = ctrltag(0);
       return hashboolean(t, 0);
     case LUA_VTRUE://bool true
+      *tag = ctrltag(1);
       return hashboolean(t, 1);
     case LUA_VLIGHTUSERDATA: {// 指针类型（不需要GC）
       void *p = pvalue(key);//获取对应的指针
-      return hashpointer(t, p);//获取p指针指向的地址值对表t的散列表Node大小的余,对应的节点
+      *tag = ctrltag(point2uint(p));
+      return hashpointer(t, p);//获取p指针指向的地址值对表t的散列表Node大小的余
     }
     case LUA_VLCF: {// key为c函数类型
       lua_CFunction f = fvalue(key);//获取轻量C函数 
-      return hashpointer(t, f);// 获取f函数指针指向的地址值对表t的散列表Node大小的余,对应的节点 
+      *tag = ctrltag(point2uint(f));
+      return hashpointer(t, f);// 获取f函数指针指向的地址值对表t的散列表Node大小的余
     }
     default: {
       GCObject *o = gcvalue(key);//默认情况获取key作为GC对象
-      return hashpointer(t, o);//获取GC对象o指针指向的地址值对表t的散列表Node大小的余,对应的节点
+      *tag = ctrltag(point2uint(o));
+      return hashpointer(t, o);//获取GC对象o指针指向的地址值对表t的散列表Node大小的余
     }
   }
 }
 
-/// @brief 函数通过key找到主位置
-/// @param t 
-/// @param nd 
-/// @return 
-l_sinline Node *mainpositionfromnode (const Table *t, Node *nd) {
-  TValue key;
-  getnodekey(cast(lua_State *, NULL), &key, nd);
-  return mainpositionTV(t, &key);
-}
-
 
 /*
 ** Check whether key 'k1' is equal to the key in node 'n2'. This
@@ -394,21 +552,431 @@ static unsigned int setlimittosize (Table *t) {
 /// @param key 
 /// @param deadok 检查搜到的点是否被释放
 /// @return 
-static const TValue *getgeneric (Table *t, const TValue *key, int deadok) {
-  Node *n = mainpositionTV(t, key);//初始的n就是主位置结点
-  for (;;) {  /* check whether 'key' is somewhere in the chain */
-    if (equalkey(key, n, deadok))//检查n的key值和传入的key是否相等 */
-      return gval(n);  /* that's it */
-    else {//散列值冲突的解决 
-      int nx = gnext(n);//否则取链接的下一个结点的偏移
-      if (nx == 0)//无偏移，说明没有下一个结点，直接返回nil对象
-        return &absentkey;  /* not found */
-      n += nx;//取下一个结点给n
+static const TValue *searchgeneric (Table *t, const TValue *key,
+                                   int deadok) {
+  lu_byte tag;
+  unsigned int i = mainpositionTV(t, key, &tag);//从主位置开始找
+  searchnode(t, i, tag, equalkey(key, n, deadok));
+  return &absentkey;
+}
+
+
+/*
+** An entry of an old hash part counts only while it has a value: the
+** old part takes no new keys, so a moved or removed entry found there
+** must be reported as absent, to have the key inserted into the new
+** part.
+*/
+
+/// @brief 旧hash部分中的槽位只有在有值时才算找到
+/// @param slot 
+/// @return 
+static const TValue *oldentry (const TValue *slot) {
+  return isempty(slot) ? &absentkey : slot;
+}
+
+
+/*
+** Entries keep their places in traversals when 'moveentries' moves
+** them out of an old hash part: the old node keeps the key and gets a
+** LUA_VMOVED value holding the index of the node the entry went to,
+** which is marked 'key_moved'. A traversal goes through the old part
+** first, taking each moved entry from its new node, and then through
+** the table's own part, skipping marked nodes. So moving entries never
+** changes the order of a traversal in progress.
+*/
+
+#define ismoved(v)	checktag((v), LUA_VMOVED)
+
+#define setmoved(v,i) \
+	{ TValue *io_=(v); val_(io_).i = cast(lua_Integer, i); \
+	  settt_(io_, LUA_VMOVED); }
+
+
+/// @brief 返回旧hash部分的节点o中的条目迁移到的t的节点(如果那个节点仍然是这个条目),否则返回NULL
+/// @param t 
+/// @param o 
+/// @return 
+static Node *movednode (Table *t, const Node *o) {
+  if (ismoved(gval(o))) {
+    Node *n = gnode(t, cast_uint(val_(gval(o)).i));
+    if (n->u.key_moved && !isempty(gval(n))) {
+      TValue k;
+      getnodekey(cast(lua_State *, NULL), &k, n);
+      if (equalkey(&k, o, 1))  /* (old key may be dead) */
+        return n;
+    }
+  }
+  return NULL;
+}
+
+
+/// @brief 在t的hash部分查找key,找不到时再查旧hash部分(如果有)
+/// @param t 
+/// @param key 
+/// @return 
+static const TValue *getgeneric (Table *t, const TValue *key) {
+  const TValue *slot = searchgeneric(t, key, 0);
+  if (isabstkey(slot) && hasoldentries(t))  /* may be in the old part? */
+    slot = oldentry(searchgeneric(oldhashpart(t), key, 0));
+  return slot;
+}
+
+
+/*
+** {=============================================================
+** Shapes
+** ==============================================================
+*/
+
+/* size of a shape with 'n' keys and an index of size 2^'ls' */
+#define sizeshape(n,ls)	\
+	(offsetof(Shape, keys) + cast_sizet(n) * sizeof(TString *) + twoto(ls))
+
+
+/*
+** Create a shape with the keys of 'parent' (if any) plus 'key'.
+*/
+
+/// @brief 创建一个新的shape,键为parent的所有键再加上key
+/// @param L 
+/// @param parent 
+/// @param key 
+/// @return 
+static Shape *newshape (lua_State *L, Shape *parent, TString *key) {
+  int n = (parent == NULL) ? 0 : parent->nkeys + 1;
+  int ls = (n == 0) ? 0 : luaO_ceillog2(cast_uint(n) * 2);
+  int mask = twoto(ls) - 1;
+  int i;
+  Shape *s = cast(Shape *, luaM_malloc_(L, sizeshape(n, ls), 0));
+  s->parent = parent;
+  s->child = s->sibling = NULL;
+  s->nkeys = n;
+  s->marked = 0;
+  s->lsizeindex = cast_byte(ls);
+  s->index = cast(lu_byte *, &s->keys[n]);
+  memset(s->index, 0, twoto(ls));
+  for (i = 0; i < n; i++) {
+    TString *k = (i < n - 1) ? parent->keys[i] : key;
+    unsigned int h = k->hash & mask;
+    while (s->index[h] != 0)  /* find a free entry in the index */
+      h = (h + 1) & mask;
+    s->keys[i] = k;
+    s->index[h] = cast_byte(i + 1);
+  }
+  return s;
+}
+
+
+/*
+** Position of 'key' in shape 's', or -1 if absent.
+*/
+
+/// @brief 查找key在shape s中的位置,不存在返回-1
+/// @param s 
+/// @param key 
+/// @return 
+static int shapeslot (const Shape *s, const TString *key) {
+  unsigned int mask = twoto(s->lsizeindex) - 1;
+  unsigned int h = key->hash & mask;
+  int k;
+  while ((k = s->index[h]) != 0) {
+    if (s->keys[k - 1] == key)
+      return k - 1;
+    h = (h + 1) & mask;
+  }
+  return -1;
+}
+
+
+/*
+** Return the shape that extends 's' with 'key', creating it if needed.
+** Return NULL if that would go beyond the shape limits. The shape is
+** marked, as it is about to be used by a table or a template that the
+** collector may have already traversed.
+*/
+
+/// @brief 得到s加上key之后的子shape,必要时创建,超出限制返回NULL
+/// @param L 
+/// @param s 
+/// @param key 
+/// @return 
+static Shape *childshape (lua_State *L, Shape *s, TString *key) {
+  global_State *g = G(L);
+  Shape *c;
+  for (c = s->child; c != NULL; c = c->sibling) {
+    if (c->keys[c->nkeys - 1] == key)
+      break;
+  }
+  if (c == NULL) {  /* not created yet? */
+    if (s->nkeys >= LUAI_MAXSHAPEKEYS || g->nshapes >= LUAI_MAXSHAPES)
+      return NULL;
+    c = newshape(L, s, key);
+    c->sibling = s->child;
+    s->child = c;
+    g->nshapes++;
+  }
+  luaH_markshape(c);
+  return c;
+}
+
+
+/*
+** The empty shape, root of all others, or NULL if shapes are disabled.
+*/
+
+/// @brief 返回空shape(所有shape的根),禁用shape时返回NULL
+/// @param L 
+/// @return 
+static Shape *rootshape (lua_State *L) {
+  global_State *g = G(L);
+  if (g->rootshape == NULL) {
+    if (LUAI_MAXSHAPES == 0)
+      return NULL;
+    g->rootshape = newshape(L, NULL, NULL);
+  }
+  return g->rootshape;
+}
+
+
+/*
+** Try to add short-string 'key' with 'value' to table 't', which either
+** has a shape or no hash part at all, by moving it to the next shape.
+** Return 0 if that is not possible.
+*/
+
+/// @brief 尝试把短字符串key放入使用shape(或没有哈希部分)的表t中,不能放入时返回0
+/// @param L 
+/// @param t 
+/// @param key 
+/// @param value 
+/// @return 
+static int shapeinsert (lua_State *L, Table *t, TString *key, TValue *value) {
+  Shape *s = t->shape;
+  Shape *ns;
+  int n;
+  if (s == NULL) {  /* table does not have a shape yet? */
+    s = rootshape(L);
+    if (s == NULL)
+      return 0;
+  }
+  ns = childshape(L, s, key);
+  if (ns == NULL)
+    return 0;
+  n = s->nkeys;
+  if (shapecap(n) < shapecap(n + 1))  /* must grow 'fields'? */
+    t->fields = cast(TValue *, luaM_saferealloc_(L, t->fields,
+                       shapecap(n) * sizeof(TValue),
+                       shapecap(n + 1) * sizeof(TValue)));
+  setobj2t(L, &t->fields[n], value);
+  t->shape = ns;
+  return 1;
+}
+
+
+/*
+** Move the elements of a table with a shape into a regular hash part,
+** with room for 'extra' more keys. The new hash part is allocated while
+** 't' still has its shape, so that a collection (or an allocation
+** error) there sees a consistent table; moving the elements into it
+** does not allocate.
+*/
+
+/// @brief 把使用shape的表转换成普通哈希表,并预留extra个位置
+/// @param L 
+/// @param t 
+/// @param extra 
+static void unshape (lua_State *L, Table *t, int extra) {
+  Shape *s = t->shape;
+  TValue *fields = t->fields;
+  unsigned int n = extra;
+  int i;
+  for (i = 0; i < s->nkeys; i++) {
+    if (!isempty(&fields[i]))
+      n++;
+  }
+  luaH_resize(L, t, luaH_realasize(t), n);
+  t->shape = NULL;
+  t->fields = NULL;
+  for (i = 0; i < s->nkeys; i++) {
+    if (!isempty(&fields[i])) {
+      TValue k;
+      setsvalue(L, &k, s->keys[i]);
+      luaH_set(L, t, &k, &fields[i]);
+    }
+  }
+  luaM_freearray(L, fields, shapecap(s->nkeys));
+}
+
+
+/*
+** Shape of the tables built by adding the 'n' distinct 'keys', in that
+** order, to an empty table, or NULL if it goes beyond the shape limits.
+** Used by the compiler for table templates (see 'OP_NEWTEMPLATE').
+*/
+
+/// @brief 返回依次向空表加入n个不同的keys后得到的shape,超出限制时返回NULL
+/// @param L 
+/// @param keys 
+/// @param n 
+/// @return 
+Shape *luaH_templateshape (lua_State *L, TString *const *keys, int n) {
+  Shape *s = rootshape(L);
+  int i;
+  for (i = 0; s != NULL && i < n; i++)
+    s = childshape(L, s, keys[i]);
+  return s;
+}
+
+
+/*
+** Give the new (still empty) table 't' shape 's', with the values of
+** its fields copied from 'values'. The fields are allocated before 't'
+** changes, so that an emergency collection sees a consistent table.
+*/
+
+/// @brief 让新建的空表t使用shape s,字段的值从values复制
+/// @param L 
+/// @param t 
+/// @param s 
+/// @param values 
+void luaH_setshape (lua_State *L, Table *t, Shape *s, const TValue *values) {
+  TValue *fields = luaM_newvector(L, shapecap(s->nkeys), TValue);
+  lua_assert(t->shape == NULL && isdummy(t) && s->nkeys > 0);
+  memcpy(fields, values, s->nkeys * sizeof(TValue));
+  t->fields = fields;
+  t->shape = s;
+  luaH_markshape(s);
+  invalidateTMcache(t);  /* its keys may be metamethod names */
+}
+
+
+/*
+** Mark shape 's' as in use in the current cycle, and with it all its
+** ancestors, which hold the prefixes of its keys. Marked shapes always
+** have marked parents, so the walk can stop at the first one.
+*/
+
+/// @brief 标记shape s(以及它的所有祖先)在本轮GC中正在使用
+/// @param s 
+void luaH_markancestors (Shape *s) {
+  for (; s != NULL && !s->marked; s = s->parent)
+    s->marked = 1;
+}
+
+
+/*
+** Clear the marks of the shapes in the list 's' and in their subtrees.
+** Unmarked shapes have no marked descendants, so their subtrees can
+** be skipped.
+*/
+
+/// @brief 清除链表s(及其子树)中所有shape的标记
+/// @param s 
+static void unmarkshapetree (Shape *s) {
+  for (; s != NULL; s = s->sibling) {
+    if (s->marked) {
+      s->marked = 0;
+      unmarkshapetree(s->child);
     }
   }
 }
 
 
+/*
+** Clear the marks of all shapes, at the start of a collection cycle.
+** Shapes still in use will be marked again as the collector traverses
+** their tables and templates, or as tables and templates get them.
+*/
+
+/// @brief 在一轮GC开始时清除所有shape的标记
+/// @param g 
+void luaH_unmarkshapes (global_State *g) {
+  if (g->rootshape != NULL)
+    unmarkshapetree(g->rootshape->child);
+}
+
+
+/*
+** Free the trees of shapes in the list 's'. Return the number of shapes
+** freed.
+*/
+
+/// @brief 释放链表s中的所有shape树,返回释放的shape数量
+/// @param L 
+/// @param s 
+/// @return 
+static int freeshapetree (lua_State *L, Shape *s) {
+  int n = 0;
+  while (s != NULL) {
+    Shape *next = s->sibling;
+    n += freeshapetree(L, s->child) + 1;
+    luaM_freemem(L, s, sizeshape(s->nkeys, s->lsizeindex));
+    s = next;
+  }
+  return n;
+}
+
+
+/*
+** Free the shapes that the last atomic phase took out of the tree (see
+** 'markshapes' in lgc.c). Called by the collector once the dead tables
+** of that cycle, the only ones that may still point to them, are freed.
+*/
+
+/// @brief 释放上一次原子阶段从shape树中摘下的shape(清扫结束后调用)
+/// @param L 
+void luaH_sweepshapes (lua_State *L) {
+  global_State *g = G(L);
+  g->nshapes -= freeshapetree(L, g->deadshapes);
+  g->deadshapes = NULL;
+}
+
+
+/// @brief 释放所有的shape(关闭状态机时调用)
+/// @param L 
+void luaH_freeshapes (lua_State *L) {
+  global_State *g = G(L);
+  luaH_sweepshapes(L);
+  freeshapetree(L, g->rootshape);
+  g->rootshape = NULL;
+  g->nshapes = 0;
+}
+
+/* }============================================================= */
+
+
+/*
+** Invalidate all entries of the cache of '__index' chains by moving to
+** a new version. If the version wraps around, old entries could become
+** valid again, so the cache is emptied.
+*/
+/// @brief 让__index链缓存全部失效
+/// @param g
+void luaH_invalidatechains (global_State *g) {
+  if (l_unlikely(++g->idxversion == 0)) {  /* wrapped around? */
+    int i;
+    for (i = 0; i < INDEXCACHE_N; i++)
+      g->idxcache[i].mt = NULL;
+  }
+}
+
+
+/*
+** Slow path of 'luaH_checkwrite', for frozen tables and tables in
+** '__index' chains.
+*/
+
+/// @brief 修改带BITCHAIN标记的表:冻结的表报错,否则让__index链缓存失效
+/// @param L
+/// @param t
+void luaH_writeguard (lua_State *L, Table *t) {
+  if (isfrozen(t))
+    luaG_runerror(L, "attempt to modify a frozen table");
+  luaH_invalidatechains(G(L));
+}
+
+
 /*
 ** returns the index for 'k' if 'k' is an appropriate key to live in
 ** the array part of a table, 0 otherwise.
@@ -444,49 +1012,178 @@ static unsigned int findindex (lua_State *L, Table *t, TValue *key,
   i = ttisinteger(key) ? arrayindex(ivalue(key)) : 0;
   if (i - 1u < asize)  /* is 'key' inside array part? *///在数组部分
     return i;  /* yes; that's the index */
+  else if (t->shape != NULL) {  /* keys are in the shape *///键在shape中
+    int k = ttisshrstring(key) ? shapeslot(t->shape, tsvalue(key)) : -1;
+    if (k >= 0)
+      return (k + 1) + asize;
+  }
   else {
-    const TValue *n = getgeneric(t, key, 1);//找到hash中的位置
-    if (l_unlikely(isabstkey(n)))
-      luaG_runerror(L, "invalid key to 'next'");  /* key not found */
-    i = cast_int(nodefromval(n) - gnode(t, 0));  /* key index in hash table *///哈希表中的键索引
-    /* hash elements are numbered after array ones */
-    return (i + 1) + asize;
+    /* hash elements are numbered after array ones, and the elements of
+       the table's own part after those of its old part (if any) */
+    Table *o = oldhashpart(t);
+    unsigned int osize = (o != NULL) ? cast_uint(sizenode(o)) : 0;
+    const TValue *n = searchgeneric(t, key, 1);//找到hash中的位置
+    if (!isabstkey(n) && (o == NULL || !nodefromval(n)->u.key_moved)) {
+      unsigned int j = cast_uint(nodefromval(n) - gnode(t, 0));  /* key index in hash table *///哈希表中的键索引
+      return (j + 1) + asize + osize;
+    }
+    if (o != NULL) {  /* moved from the old part, or still there? */
+      n = searchgeneric(o, key, 1);
+      if (!isabstkey(n))
+        return cast_uint(nodefromval(n) - gnode(o, 0)) + 1 + asize;
+    }
   }
+  /* an integer key found nowhere may have been in a slice of the array
+     part released by 'luaH_trimarray' (all slots after it were empty);
+     go on with the hash part */
+  if (i != 0)
+    return asize;
+  luaG_runerror(L, "invalid key to 'next'");  /* key not found */
+  return 0;  /* to avoid warnings */
 }
 
-/// @brief 根据key找到下一个key，迭代器的实现是用key去遍历的
-// 对lua表进行迭代访问，每次访问的时候 ，会调用luaH_next
-/// @param L 
-/// @param t 
-/// @param key 
-/// @return 
-int luaH_next (lua_State *L, Table *t, StkId key) {
-  unsigned int asize = luaH_realasize(t);//得到数组真实长度
-  unsigned int i = findindex(L, t, s2v(key), asize);  /* find original key *///得到索引
+/*
+** Check whether 'pos' (an index as returned by 'findindex') is still the
+** position of 'key' in table 't'. Positions in the hash part shift when
+** 'luaH_trimarray' shrinks the array part, and then 'pos' could land on
+** a dead copy of 'key'; so, in a trimmed table, only a live entry there
+** proves it.
+*/
+static int checkindex (Table *t, const TValue *key, unsigned int pos,
+                                                    unsigned int asize) {
+  int deadok = !t->trimmed;
+  if (pos == 0)
+    return ttisnil(key);
+  pos--;
+  if (pos < asize)  /* array part? */
+    return ttisinteger(key) && l_castS2U(ivalue(key)) - 1u == pos;
+  pos -= asize;
+  if (t->shape != NULL)
+    return pos < cast_uint(t->shape->nkeys) && ttisshrstring(key) &&
+           t->shape->keys[pos] == tsvalue(key);
+  if (t->oldhash != NULL) {
+    Table *o = oldhashpart(t);
+    if (pos < cast_uint(sizenode(o))) {  /* old part? */
+      Node *n = gnode(o, pos);
+      return equalkey(key, n, 1) &&
+             (deadok || !isempty(gval(n)) || movednode(t, n) != NULL);
+    }
+    pos -= sizenode(o);
+  }
+  if (pos < cast_uint(sizenode(t))) {
+    Node *n = gnode(t, pos);
+    return equalkey(key, n, 1) && (deadok || !isempty(gval(n)));
+  }
+  return 0;
+}
+
+
+/*
+** Put in 'key' and 'key + 1' the first non-empty entry of 't' from
+** position 'i' on, returning its position plus one (the index
+** 'findindex' gives for that key); return 0 if there are no more
+** entries.
+*/
+static unsigned int nextfrom (lua_State *L, Table *t, StkId key,
+                              unsigned int i, unsigned int asize) {
+  unsigned int base;
   for (; i < asize; i++) {  /* try first array part *///在数组中查找
     if (!isempty(&t->array[i])) {  /* a non-empty entry? *///如果不是nil
       setivalue(s2v(key), i + 1);
       setobj2s(L, key + 1, &t->array[i]);
-      return 1;
+      return i + 1;
     }
   }
-  for (i -= asize; cast_int(i) < sizenode(t); i++) {  /* hash part *///hash部分
-    if (!isempty(gval(gnode(t, i)))) {  /* a non-empty entry? *///不是nil
-      Node *n = gnode(t, i);//获取node
+  if (t->shape != NULL) {  /* fields of a shape? *///shape的各个字段
+    for (i -= asize; i < cast_uint(t->shape->nkeys); i++) {
+      if (!isempty(&t->fields[i])) {
+        setsvalue2s(L, key, t->shape->keys[i]);
+        setobj2s(L, key + 1, &t->fields[i]);
+        return asize + i + 1;
+      }
+    }
+    return 0;
+  }
+  i -= asize;
+  base = asize;
+  if (t->oldhash != NULL) {  /* first the old hash part */
+    Table *o = oldhashpart(t);
+    for (; i < cast_uint(sizenode(o)); i++) {
+      Node *n = gnode(o, i);
+      if (ismoved(gval(n)))
+        n = movednode(t, n);  /* the entry is in its new node, if anywhere */
+      if (n != NULL && !isempty(gval(n))) {
+        getnodekey(L, s2v(key), n);
+        setobj2s(L, key + 1, gval(n));
+        return base + i + 1;
+      }
+    }
+    i -= sizenode(o);  /* index into the table's own part */
+    base += sizenode(o);
+  }
+  for (; i < cast_uint(sizenode(t)); i++) {  /* hash part *///hash部分
+    Node *n = gnode(t, i);//获取node
+    if (!isempty(gval(n)) &&  /* a non-empty entry? *///不是nil
+        !(n->u.key_moved && t->oldhash != NULL)) {  /* not visited before? */
       getnodekey(L, s2v(key), n);
       setobj2s(L, key + 1, gval(n));
-      return 1;
+      return base + i + 1;
     }
   }
   return 0;  /* no more elements */
 }
 
+
+/// @brief 根据key找到下一个key，迭代器的实现是用key去遍历的
+// 对lua表进行迭代访问，每次访问的时候 ，会调用luaH_next
+/// @param L 
+/// @param t 
+/// @param key 
+/// @return 
+int luaH_next (lua_State *L, Table *t, StkId key) {
+  unsigned int asize = luaH_realasize(t);//得到数组真实长度
+  unsigned int i = findindex(L, t, s2v(key), asize);  /* find original key *///得到索引
+  return (nextfrom(L, t, key, i, asize) != 0);
+}
+
+
+/*
+** Stateful variant of 'luaH_next' for generic 'for' loops: 'pos' is the
+** result of the previous call for this traversal (or 0), and it is used
+** instead of searching 'key' again while it still points to that key.
+** Returns the new position, or 0 when there are no more elements.
+*/
+
+/// @brief 带位置的luaH_next:pos仍然指向key时直接从那里继续遍历,不再查找key;返回新位置,没有更多元素时返回0
+/// @param L 
+/// @param t 
+/// @param key 
+/// @param pos 上一次调用返回的位置
+/// @return 
+unsigned int luaH_nextpos (lua_State *L, Table *t, StkId key,
+                                                   unsigned int pos) {
+  unsigned int asize = luaH_realasize(t);
+  if (l_unlikely(!checkindex(t, s2v(key), pos, asize)))
+    pos = findindex(L, t, s2v(key), asize);  /* find original key */
+  return nextfrom(L, t, key, pos, asize);
+}
+
+
 /// @brief 释放hash
 /// @param L 
 /// @param t 
 static void freehash (lua_State *L, Table *t) {
   if (!isdummy(t))//hash不是空
-    luaM_freearray(L, t->node, cast_sizet(sizenode(t)));//释放hash
+    luaM_freemem(L, t->node, sizehashpart(sizenode(t)));//释放hash(包括控制字节)
+}
+
+
+/// @brief 释放旧hash部分
+/// @param L 
+/// @param old 
+static void freeoldhash (lua_State *L, OldHash *old) {
+  freehash(L, &old->h);
+  luaM_free(L, old);
 }
 
 
@@ -625,15 +1322,36 @@ static int numusehash (const Table *t, unsigned int *nums, unsigned int *pna) {
 
 
 /*
-** Creates an array for the hash part of a table with the given
-** size, or reuses the dummy node if size is zero.
+** Empty all nodes of the (non-dummy) hash part of 't'; all of them
+** can take new keys again.
+*/
+
+/// @brief 清空t的hash部分的所有节点(不能是dummynode),清空后所有节点都可以重新使用
+/// @param t 
+static void emptyhash (Table *t) {
+  unsigned int i;
+  unsigned int size = sizenode(t);
+  for (i = 0; i < size; i++) {//对Node填nil
+    Node *n = gnode(t, i);
+    setnilkey(n);
+    n->u.key_moved = 0;
+    setempty(gval(n));
+  }
+  memset(ctrlbytes(t), CTRL_EMPTY, size + GROUPSIZE);
+  t->lastfree = gnode(t, hashcapacity(size));  /* all positions are free *///设置还能使用的节点数
+}
+
+
+/*
+** Creates an array for the hash part of a table with room for the
+** given number of keys, or reuses the dummy node if size is zero.
 ** The computation for size overflow is in two steps: the first
 ** comparison ensures that the shift in the second one does not
 ** overflow.
 */
 
-/// @brief 创建新的Node数组,lastfree会在这里重新指向数组尾
-// node数组的大小为size向上取整为2的幂
+/// @brief 创建新的Node数组(后面跟着控制字节),lastfree会在这里重新设置为可用的节点数
+// node数组的大小为能容纳size个key的2的幂
 // 如果要保留table的旧node则应该在本函数被调用前保存
 /// @param L 
 /// @param t 
@@ -645,20 +1363,16 @@ static void setnodevector (lua_State *L, Table *t, unsigned int size) {
     t->lastfree = NULL;  /* signal that it is using dummy node */
   }
   else {
-    int i;
     int lsize = luaO_ceillog2(size);// 整理成特殊要求的size 得到size的以2为底的对数
+    /* one more bit if the keys would go over the maximum load */
+    if (lsize <= MAXHBITS && hashcapacity(1u << lsize) < size)
+      lsize++;
     if (lsize > MAXHBITS || (1u << lsize) > MAXHSIZE)
       luaG_runerror(L, "table overflow");
     size = twoto(lsize);//还原成 1024这样的普通数
-    t->node = luaM_newvector(L, size, Node);//申请全新的MEM.Node
-    for (i = 0; i < (int)size; i++) {//对新的Node填nil 
-      Node *n = gnode(t, i);
-      gnext(n) = 0;
-      setnilkey(n);
-      setempty(gval(n));
-    }
+    t->node = cast(Node *, luaM_malloc_(L, sizehashpart(size), 0));//申请全新的MEM.Node
     t->lsizenode = cast_byte(lsize);//设置lsizenode大小
-    t->lastfree = gnode(t, size);  /* all positions are free *///设置lastfree位置
+    emptyhash(t);
   }
 }
 
@@ -718,7 +1432,8 @@ static void exchangehashpart (Table *t1, Table *t2) {
 ** raises the allocation error. Otherwise, it sets the new hash part
 ** into the table, initializes the new part of the array (if any) with
 ** nils and reinserts the elements of the old hash back into the new
-** parts of the table.
+** parts of the table. An old hash part still being moved (if any) is
+** reinserted and freed too.
 */
 
 /// @brief 按照numusehash,computesizes之前计算的结果重新分配空间
@@ -730,10 +1445,16 @@ void luaH_resize (lua_State *L, Table *t, unsigned int newasize,
                                           unsigned int nhsize) {
   unsigned int i;
   Table newt;  /* to keep the new hash part *///newt用来作为中转，并按照所需长度进行初始化
+  OldHash *old = t->oldhash;  /* hash part still being moved, if any */
   unsigned int oldasize = setlimittosize(t);
   TValue *newarray;
+  luaH_chainchange(G(L), t);  /* slots will move */
+  t->trimmed = 0;  /* old positions are void anyway */
   /* create new hash part with appropriate size into 'newt' */
   setnodevector(L, &newt, nhsize);
+  /* keys in the vanishing slice are not in any hash part; detaching the
+     old part keeps insertions below from moving its entries */
+  t->oldhash = NULL;
   if (newasize < oldasize) {  /* will array shrink? *///数组部分需要缩小的情况
     t->alimit = newasize;  /* pretend array has new size... */
     exchangehashpart(t, &newt);  /* and new hash *///将旧的散列表中的内容放到中转散列表中
@@ -749,6 +1470,7 @@ void luaH_resize (lua_State *L, Table *t, unsigned int newasize,
   newarray = luaM_reallocvector(L, t->array, oldasize, newasize, TValue);//按照新数组部分的长度申请内存 这里已经将老数组的内容拷贝到新数组中了
   if (l_unlikely(newarray == NULL && newasize > 0)) {  /* allocation failed? */
     freehash(L, &newt);  /* release new hash part *///分配内存失败
+    t->oldhash = old;
     luaM_error(L);  /* raise error (with array unchanged) */
   }
   /* allocation ok; initialize new part of the array */
@@ -765,6 +1487,10 @@ void luaH_resize (lua_State *L, Table *t, unsigned int newasize,
   //此时散列表中既包括了老的散列表的内容，也包括了从数组中移出来的部分
   reinsert(L, &newt, t);  /* 'newt' now has the old hash */
   freehash(L, &newt);  /* free old hash part *///释放中转散列表
+  if (old != NULL) {  /* also move what was left in the older part */
+    reinsert(L, &old->h, t);
+    freeoldhash(L, old);
+  }
 }
 
 /// @brief 调整数组大小
@@ -773,9 +1499,33 @@ void luaH_resize (lua_State *L, Table *t, unsigned int newasize,
 /// @param nasize 
 void luaH_resizearray (lua_State *L, Table *t, unsigned int nasize) {
   int nsize = allocsizenode(t);
+  if (t->oldhash != NULL)  /* keys of the old part go to the new one too */
+    nsize += sizenode(oldhashpart(t));
   luaH_resize(L, t, nasize, nsize);
 }
 
+/*
+** Count the keys in all parts of table 't' (see 'numusehash'); also
+** sets its limit to the real size of the array part.
+*/
+
+/// @brief 统计表中所有部分的key数量,pna返回其中可以放进数组部分的整数key数量
+/// @param t 
+/// @param nums 
+/// @param pna 
+/// @return 所有类型的key的总数
+static int numuse (Table *t, unsigned int *nums, unsigned int *pna) {
+  int totaluse;
+  setlimittosize(t);//设置alimit为表数组部分的实际大小，并设置对应的flags，返回表数组部分的实际大小
+  *pna = numusearray(t, nums);  /* count keys in array part *///统计数组部分已经使用的元素数量
+  totaluse = *pna;  /* all those keys are integer keys */
+  totaluse += numusehash(t, nums, pna);  /* count keys in hash part *///统计散列表部分已经使用的节点数量
+  if (t->oldhash != NULL)  /* and in the part still being moved */
+    totaluse += numusehash(oldhashpart(t), nums, pna);
+  return totaluse;
+}
+
+
 /*
 ** nums[i] = number of keys 'k' where 2^(i - 1) < k <= 2^i
 */
@@ -791,10 +1541,7 @@ static void rehash (lua_State *L, Table *t, const TValue *ek) {
   int i;
   int totaluse;//记录表中key元素的总数 
   for (i = 0; i <= MAXABITS; i++) nums[i] = 0;  /* reset counts */
-  setlimittosize(t);//设置alimit为表数组部分的实际大小，并设置对应的flags，返回表数组部分的实际大小
-  na = numusearray(t, nums);  /* count keys in array part *///统计数组部分已经使用的元素数量
-  totaluse = na;  /* all those keys are integer keys */
-  totaluse += numusehash(t, nums, &na);  /* count keys in hash part *///统计散列表部分已经使用的节点数量
+  totaluse = numuse(t, nums, &na);
   /* count extra key */
   if (ttisinteger(ek))//需要插入的ek如果是整型
     na += countint(ivalue(ek), nums);//新增的key也要考虑进去
@@ -806,6 +1553,214 @@ static void rehash (lua_State *L, Table *t, const TValue *ek) {
 }
 
 
+/*
+** Compute the sizes a rehash would give table 't' for its current keys:
+** the size of the array part goes to '*pasize', and the number of keys
+** left for the hash part is returned.
+*/
+
+/// @brief 计算按当前的key重新rehash时表的大小:数组部分大小放入pasize,返回hash部分的key数量
+/// @param t 
+/// @param pasize 
+/// @return 
+static unsigned int optimalsizes (Table *t, unsigned int *pasize) {
+  unsigned int na;
+  unsigned int nums[MAXABITS + 1];
+  unsigned int total;
+  int i;
+  for (i = 0; i <= MAXABITS; i++) nums[i] = 0;  /* reset counts */
+  total = cast_uint(numuse(t, nums, &na));
+  *pasize = computesizes(nums, &na);
+  return total - na;  /* keys going to the hash part */
+}
+
+
+/*
+** Resize table 't' to the sizes a rehash would compute for its current
+** keys, if that makes any of its parts smaller (or finishes a pending
+** incremental rehash). Removed entries are dropped, so, as when adding
+** a key, the table must not be in the middle of a traversal. Returns
+** whether the table was resized. Tables with a shape are left alone,
+** as their values are already packed, and so are frozen tables.
+*/
+
+/// @brief 按当前的key数量压缩表,只有某一部分能变小(或有未完成的增量rehash)时才调整,返回是否调整了大小
+/// @param L 
+/// @param t 
+/// @return 
+int luaH_compact (lua_State *L, Table *t) {
+  unsigned int asize;
+  unsigned int nhsize;
+  unsigned int hsize = allocsizenode(t);
+  if (t->shape != NULL || isfrozen(t))
+    return 0;
+  nhsize = optimalsizes(t, &asize);
+  if (asize < luaH_realasize(t) || t->oldhash != NULL ||
+      (hsize > 0 && (nhsize == 0 || nhsize <= hashcapacity(hsize / 2)))) {
+    luaH_resize(L, t, asize, nhsize);
+    return 1;
+  }
+  return 0;
+}
+
+
+/*
+** Shrink the array part of 't' to the smallest power of 2 that holds its
+** last non-empty slot, leaving the hash part alone. No entry moves and
+** no removed key is dropped, so, unlike 'luaH_compact', this is safe in
+** the middle of a traversal (see 'findindex'). It never raises errors:
+** if the smaller block cannot be allocated, the table stays as it was.
+** Returns whether the array part shrank.
+*/
+
+/// @brief 释放数组部分末尾的空槽位(缩小到能容纳最后一个非空元素的2的幂),不动hash部分,遍历中也可以调用;返回是否缩小了
+/// @param L 
+/// @param t 
+/// @return 
+int luaH_trimarray (lua_State *L, Table *t) {
+  unsigned int asize = setlimittosize(t);
+  unsigned int n = asize;
+  unsigned int nsize;
+  TValue *newarray;
+  while (n > 0 && isempty(&t->array[n - 1]))  /* find last non-empty slot */
+    n--;
+  nsize = (n == 0) ? 0 : 1u << luaO_ceillog2(n);
+  if (nsize >= asize)
+    return 0;
+  newarray = luaM_reallocvector(L, t->array, asize, nsize, TValue);
+  if (newarray == NULL && nsize > 0)  /* allocation failed? */
+    return 0;  /* keep the old block */
+  luaH_chainchange(G(L), t);  /* slots will move */
+  t->array = newarray;
+  t->alimit = nsize;
+  t->trimmed = 1;  /* positions in the hash part shifted */
+  return 1;
+}
+
+
+/*
+** A search in a hash part where no run of used nodes is as long as a
+** group reads a single group, whether the key is there or not: a key
+** is never further than a group from its main position, and every
+** group has a never-used node, where searches stop.
+*/
+
+/// @brief t的hash部分中是否所有查找都只读一组控制字节(没有长度达到一组的连续已用节点)
+/// @param t 
+/// @return 
+static int singlegroup (Table *t) {
+  const lu_byte *ctrl = ctrlbytes(t);
+  unsigned int size = sizenode(t);
+  unsigned int i, run = 0;
+  if (size <= GROUPSIZE)  /* whole part fits in one group? */
+    return 1;
+  for (i = 0; i < size + GROUPSIZE; i++) {  /* (copies cover wrapping runs) */
+    if (ctrl[i] == CTRL_EMPTY)
+      run = 0;
+    else if (++run >= GROUPSIZE)
+      return 0;
+  }
+  return 1;
+}
+
+
+/*
+** Freeze table 't': rebuild it with the sizes a rehash would compute,
+** doubling its hash part (up to LUAI_FREEZEGROW times) until all
+** searches read a single group (see 'singlegroup'); if no size tried
+** gets there, go back to the computed size, as the larger hash parts
+** would only cost memory. Then mark the table so that
+** any later change raises an error. A table with a shape keeps it:
+** its values are already packed and its small index finds keys
+** directly. Frozen tables never get the write barriers that would make
+** an old table be traversed again in generational mode.
+*/
+
+/// @brief 冻结表t:按当前key重建表(必要时加大hash部分,让每次查找只读一组),之后任何修改都会报错
+/// @param L 
+/// @param t 
+void luaH_freeze (lua_State *L, Table *t) {
+  if (isfrozen(t))
+    return;
+  if (t->shape == NULL) {
+    unsigned int asize;
+    unsigned int nhsize = optimalsizes(t, &asize);
+    int i;
+    luaH_resize(L, t, asize, nhsize);
+    for (i = 0; i < LUAI_FREEZEGROW && !singlegroup(t); i++) {
+      unsigned int size = 2 * sizenode(t);
+      luaH_resize(L, t, asize, hashcapacity(size));  /* 'size' nodes */
+    }
+    if (i > 0 && !singlegroup(t))  /* grew for nothing? */
+      luaH_resize(L, t, asize, nhsize);
+  }
+  t->frozen = 1;
+  setchainmember(t);  /* changes go through 'luaH_writeguard' */
+}
+
+
+/*
+** Remove all entries from table 't', keeping its array part, its hash
+** part and its shape (if any), so that it can be refilled without
+** being resized. (An old hash part still being moved is freed.) As
+** with any removal of keys, 't' must not be in the middle of a
+** traversal.
+*/
+
+/// @brief 清空表t的所有元素,保留数组部分、hash部分和shape的内存以便重复使用
+/// @param L 
+/// @param t 
+void luaH_clear (lua_State *L, Table *t) {
+  unsigned int i;
+  unsigned int asize;
+  luaH_checkwrite(L, t);
+  asize = setlimittosize(t);
+  for (i = 0; i < asize; i++)
+    setempty(&t->array[i]);
+  if (t->shape != NULL) {  /* keys stay in the shape, without values */
+    for (i = 0; i < cast_uint(t->shape->nkeys); i++)
+      setempty(&t->fields[i]);
+  }
+  if (!isdummy(t))
+    emptyhash(t);
+  if (t->oldhash != NULL) {
+    freeoldhash(L, t->oldhash);
+    t->oldhash = NULL;
+  }
+}
+
+
+/*
+** Copy src[f..e] to dst[t..] with one 'memmove' (so the ranges may
+** overlap), if both ranges are inside the array parts of the tables.
+** Returns 0, doing nothing, otherwise. Values moved into another table
+** need a barrier; one for the whole block is enough.
+*/
+
+/// @brief 两个范围都在数组部分时用一次memmove把src[f..e]复制到dst[t..],否则返回0
+/// @param L 
+/// @param src 
+/// @param f 
+/// @param e 
+/// @param dst 
+/// @param t 
+/// @return 
+int luaH_movearray (lua_State *L, Table *src, lua_Integer f, lua_Integer e,
+                                  Table *dst, lua_Integer t) {
+  if (e < f)
+    return 1;  /* nothing to move */
+  else if (f < 1 || e > cast(lua_Integer, luaH_realasize(src)) ||
+           t < 1 || t > cast(lua_Integer, luaH_realasize(dst)) - (e - f))
+    return 0;  /* some element outside the array parts */
+  luaH_checkwrite(L, dst);
+  if (dst != src && isblack(dst))
+    luaC_barrierback_(L, obj2gco(dst));
+  memmove(&dst->array[t - 1], &src->array[f - 1],
+          cast_sizet(e - f + 1) * sizeof(TValue));
+  return 1;
+}
+
+
 
 /*
 ** }=============================================================
@@ -821,6 +1776,11 @@ Table *luaH_new (lua_State *L) {
   t->flags = cast_byte(maskflags);  /* table has no metamethod fields */
   t->array = NULL;//处理数组部分
   t->alimit = 0;
+  t->shape = NULL;
+  t->fields = NULL;
+  t->oldhash = NULL;
+  t->frozen = 0;
+  t->trimmed = 0;
   setnodevector(L, t, 0);//处理node部分
   return t;
 }
@@ -829,20 +1789,55 @@ Table *luaH_new (lua_State *L) {
 /// @param L 
 /// @param t 
 void luaH_free (lua_State *L, Table *t) {
+  luaH_chainchange(G(L), t);  /* its address may be reused */
   freehash(L, t);
+  if (t->oldhash != NULL)
+    freeoldhash(L, t->oldhash);
+  if (t->shape != NULL)
+    luaM_freearray(L, t->fields, shapecap(t->shape->nkeys));
   luaM_freearray(L, t->array, luaH_realasize(t));
   luaM_free(L, t);
 }
 
-/// @brief 从这里可以看到freepos是倒序来的,主要是从后往前找,找到第一个free位置
+/*
+** Get the first node without a value in the probe sequence starting
+** at 'i': either a removed entry, which is reused (unless 'reuse' is
+** false), or a never-used node, which takes room from the table.
+** Returns NULL if there is no such node or no more room. Taking the
+** first one keeps the invariant that a live key comes before any dead
+** copy of itself in its probe sequence, which 'next' relies on (see
+** 'equalkey').
+*/
+
+/// @brief 从主位置i开始找第一个没有值的节点(已删除的(reuse为真时)或者从未用过的),没有空间时返回NULL
 /// @param t 
+/// @param i 
+/// @param reuse 是否可以重用已删除的节点
 /// @return 
-static Node *getfreepos (Table *t) {
+static Node *getfreepos (Table *t, unsigned int i, int reuse) {
   if (!isdummy(t)) {
-    while (t->lastfree > t->node) {
-      t->lastfree--;
-      if (keyisnil(t->lastfree))
-        return t->lastfree;
+    const lu_byte *ctrl = ctrlbytes(t);
+    unsigned int mask = sizenode(t) - 1;
+    unsigned int left = sizenode(t);
+    for (;;) {
+      unsigned int m = groupempty(ctrl + i);
+      int limit = (m != 0) ? lowbit(m) : GROUPSIZE;
+      int j;
+      for (j = 0; reuse && j < limit; j++) {  /* look for a removed entry */
+        Node *n = gnode(t, (i + j) & mask);
+        if (isempty(gval(n)))
+          return n;
+      }
+      if (m != 0) {  /* found a never-used node? */
+        if (t->lastfree == t->node)  /* no more room? */
+          break;
+        t->lastfree--;
+        return gnode(t, (i + limit) & mask);
+      }
+      if (left <= GROUPSIZE)  /* went through all nodes? */
+        break;
+      left -= GROUPSIZE;
+      i = (i + GROUPSIZE) & mask;
     }
   }
   return NULL;  /* could not find a free place */
@@ -851,11 +1846,127 @@ static Node *getfreepos (Table *t) {
 
 
 /*
-** inserts a new key into a hash table; first, check whether key's main
-** position is free. If not, check whether colliding node is in its main
-** position or not: if it is not, move colliding node to an empty place and
-** put new key in its main position; otherwise (colliding node is in its main
-** position), new key goes to an empty position.
+** Start an incremental rehash of 't', whose hash part is full: give it
+** a new hash part twice as large and keep the current one in 'oldhash',
+** to be emptied by 'movehash'.
+*/
+
+/// @brief 开始增量rehash:t换上两倍大的新hash部分,原来的部分放到oldhash中逐步迁移
+/// @param L 
+/// @param t 
+static void growhash (lua_State *L, Table *t) {
+  Table newt;
+  OldHash *old;
+  setnodevector(L, &newt, 2 * hashcapacity(sizenode(t)));
+  old = cast(OldHash *, luaM_realloc_(L, NULL, 0, sizeof(OldHash)));
+  if (l_unlikely(old == NULL)) {  /* allocation failed? */
+    freehash(L, &newt);
+    luaM_error(L);
+  }
+  exchangehashpart(t, &newt);  /* 't' has the new hash ('newt' has the old) */
+  old->h.node = newt.node;
+  old->h.lsizenode = newt.lsizenode;
+  old->h.lastfree = newt.lastfree;
+  old->h.flags = 0;
+  old->h.alimit = 0;
+  old->h.array = NULL;
+  old->h.metatable = NULL;
+  old->h.shape = NULL;
+  old->h.fields = NULL;
+  old->h.oldhash = NULL;
+  old->h.frozen = 0;
+  old->h.trimmed = 0;
+  old->next = 0;
+  t->oldhash = old;
+}
+
+
+/*
+** Move up to 'n' entries of the old hash part of 't' into its own hash
+** part, keeping their places in traversals (see 'movednode'). With
+** 'reuse' false, they take only never-used nodes, so that removed keys
+** keep their places too. Returns whether all entries were moved. (No
+** barrier is needed, as entries stay in the same table.)
+*/
+
+/// @brief 把旧hash部分的至多n个条目迁移到t自己的hash部分,返回是否全部迁移完了
+/// @param t 
+/// @param n 
+/// @param reuse 是否可以重用已删除的节点
+/// @return 
+static int moveentries (Table *t, int n, int reuse) {
+  OldHash *old = t->oldhash;
+  unsigned int size = sizenode(&old->h);
+  for (; n > 0 && old->next < size; n--, old->next++) {
+    Node *o = gnode(&old->h, old->next);
+    if (!isempty(gval(o))) {
+      TValue k;
+      lu_byte tag;
+      Node *f;
+      unsigned int i;
+      getnodekey(cast(lua_State *, NULL), &k, o);
+      f = getfreepos(t, mainpositionTV(t, &k, &tag), reuse);
+      if (f == NULL)  /* no room? ('luaH_newkey' will rehash it all) */
+        return 0;
+      i = cast_uint(f - gnode(t, 0));
+      setctrl(t, i, tag);
+      setnodekey(cast(lua_State *, NULL), f, &k);
+      f->u.key_moved = 1;
+      setobj2t(cast(lua_State *, NULL), gval(f), gval(o));
+      setmoved(gval(o), i);
+    }
+  }
+  return (old->next == size);
+}
+
+
+/*
+** Move up to 'n' entries of the old hash part of 't' (see
+** 'moveentries'), freeing it after its last entry is moved. Only
+** insertions call it, as freeing the old part changes the order of
+** traversals.
+*/
+
+/// @brief 把旧hash部分的至多n个条目迁移到t自己的hash部分,全部迁移完后释放旧部分
+/// @param L 
+/// @param t 
+/// @param n 
+static l_noinline void movehash (lua_State *L, Table *t, int n) {
+  OldHash *old = t->oldhash;
+  if (moveentries(t, n, 1)) {  /* all moved? */
+    t->oldhash = NULL;
+    freeoldhash(L, old);
+  }
+}
+
+
+/*
+** Move all entries left in the old hash part of 't', so that a table
+** that stops growing does not keep searching two parts. The collector
+** does it when traversing the table, which may be in the middle of a
+** traversal; so the entries take only never-used nodes, and the old
+** part (now with only moved entries) stays until the next insertion.
+*/
+
+/// @brief 把旧hash部分剩下的条目全部迁移到t自己的hash部分(由GC调用),旧部分留到下一次插入时释放
+/// @param g 
+/// @param t 
+void luaH_finishmove (global_State *g, Table *t) {
+  if (hasoldentries(t)) {
+    luaH_chainchange(g, t);  /* slots will move */
+    moveentries(t, MAX_INT, 0);
+  }
+}
+
+
+/*
+** inserts a new key into a hash table, in the first node without a
+** value in its probe sequence (see 'getfreepos'). If there is none,
+** rehash the table and try again: a full rehash, or the start of an
+** incremental one for a large hash part getting a non-integer key
+** (integer keys may need a larger array part, which only a full
+** rehash computes). While an incremental rehash is going on, each
+** insertion also moves some entries from the old hash part.
 */
 
 /// @brief  这个函数的主要功能将一个key插入哈希表，并返回key关联的value指针。
@@ -866,6 +1977,8 @@ static Node *getfreepos (Table *t) {
 void luaH_newkey (lua_State *L, Table *t, const TValue *key, TValue *value) {
   Node *mp;
   TValue aux;
+  lu_byte tag;
+  unsigned int i;
   if (l_unlikely(ttisnil(key)))//key是空值 报错 看到了么，tbl不支持nil的key
     luaG_runerror(L, "table index is nil");
   else if (ttisfloat(key)) {//key是float 转成int 不能就报错
@@ -880,48 +1993,33 @@ void luaH_newkey (lua_State *L, Table *t, const TValue *key, TValue *value) {
   }
   if (ttisnil(value))//值是nil类型
     return;  /* do not insert nil values */
-  mp = mainpositionTV(t, key);//mp位根据哈希值得到的应该插入位置的节点
-  if (!isempty(gval(mp)) || isdummy(t)) {  /* main position is taken? */
-    // mp节点已经有值
-    // 此时存在两种情况
-    //   1.本次要新加的对象和现在存在这里的对象出现了碰撞,这个时候需要吧新的对象放到后面的第一个空位中,并从逻辑上将其链接到该位置的链表上
-    //   2.现在存放在这里的对象的hash值不在这里,是因为跟其他位置发送的碰撞后存放在这里的,这时需要将现在存放在这里的对象放到后面第一个空位上
-    //     新加的对象存放在这里
-
-    Node *othern;
-    Node *f = getfreepos(t);  /* get a free place *///无论以上那种情况,都需要寻找下一个空的位置
-    if (f == NULL) {  /* cannot find a free place? *///slot全满，则只能重新rehash扩容了
-      rehash(L, t, key);  /* grow table */// 扩容
-      /* whatever called 'newkey' takes care of TM cache */
-      luaH_set(L, t, key, value);  /* insert key into grown table *///将value添加到表里
+  luaH_chainchange(G(L), t);
+  if (t->shape != NULL || isdummy(t)) {  /* shape may take the key? */
+    if (ttisshrstring(key) && shapeinsert(L, t, tsvalue(key), value))
       return;
-    }
-    lua_assert(!isdummy(t));//hash表不空
-    othern = mainpositionfromnode(t, mp);//计算现在存放在这里的对象mp本来应该放在那个位置
-    if (othern != mp) {  /* is colliding node out of its main position? *///对象本来不应该放在这里,说明在别处碰撞后放在了这里
-      /* yes; move colliding node into free position */
-      while (othern + gnext(othern) != mp)  /* find previous *///顺着othern的一路找到mp的前置节点
-        othern += gnext(othern);
-      gnext(othern) = cast_int(f - othern);  /* rechain to point to 'f' *///本来前置节点指向的是mp的位置,现在改为指向新找的空位f
-      *f = *mp;  /* copy colliding node into free pos. (mp->next also goes) *///将mp存到f
-      if (gnext(mp) != 0) {    //处理mp的后继节点
-        gnext(f) += cast_int(mp - f);  /* correct 'next' */
-        gnext(mp) = 0;  /* now 'mp' is free */
-      }
-      setempty(gval(mp));//将它腾出来的，原本属于我的位置的value域填入nil值(擦除残留的值) 
-    }
-    else {  /* colliding node is in its own main position *///对象本来就应该放在这里,说明跟本次要新加的对象发生了碰撞
-      /* new node will go into free position */
-      if (gnext(mp) != 0)// 这里从逻辑上,新加的对象插到mp和后继链表的中间,避免遍历链表的消耗,f的下一个位置指向mp的下一个位置
-        gnext(f) = cast_int((mp + gnext(mp)) - f);  /* chain new position */
-      else lua_assert(gnext(f) == 0);//链表的要求，这里必须gnext(f) == 0
-      gnext(mp) = cast_int(f - mp);//mp的下一个位置指向f
-      mp = f;
-    }
+    if (t->shape != NULL)  /* use a regular hash part from now on */
+      unshape(L, t, 1);
   }
+  if (l_unlikely(t->oldhash != NULL))  /* incremental rehash going on? */
+    movehash(L, t, LUAI_HASHSTEP);
+  i = mainpositionTV(t, key, &tag);//i为根据哈希值得到的主位置
+  mp = getfreepos(t, i, 1);  /* get a free place *///从主位置开始找第一个没有值的节点
+  if (mp == NULL) {  /* cannot find a free place? *///没有空间，则只能重新rehash扩容了
+    if (t->oldhash == NULL && !ttisinteger(key) &&
+        sizenode(t) >= LUAI_INCRHASH)
+      growhash(L, t);  /* grow hash part incrementally */
+    else
+      rehash(L, t, key);  /* grow table */// 扩容
+    /* whatever called 'newkey' takes care of TM cache */
+    luaH_set(L, t, key, value);  /* insert key into grown table *///将value添加到表里
+    return;
+  }
+  lua_assert(!isdummy(t));//hash表不空
+  setctrl(t, cast_uint(mp - gnode(t, 0)), tag);
 
   // 把key的值复制给mp节点,并返回节点的指针
   setnodekey(L, mp, key);
+  mp->u.key_moved = 0;
   luaC_barrierback(L, obj2gco(t), key);//进行GC的barrierback操作，确保black不会指向white 
   lua_assert(isempty(gval(mp)));//函数名为newkey，所以这里判断下val==nil，确保上面将对应的pos的val置空了
   setobj2t(L, gval(mp), value);//最后将新value赋值给mp
@@ -957,18 +2055,13 @@ const TValue *luaH_getint (Table *t, lua_Integer key) {
     return &t->array[key - 1];//返回对应数组的元素
   }
   else {
-    // 1. 这里是哈希部分，整型直接key & nodesize得到数组索引，取出结点地址返回
-    Node *n = hashint(t, key);
-    for (;;) {  /* check whether 'key' is somewhere in the chain */
-      if (keyisinteger(n) && keyival(n) == key)//2. 比较该结点的key相等(同为整型且值相同)，是则返回值
-        return gval(n);  /* that's it */// 返回n的值的指针
-      else {
-        int nx = gnext(n);// 3. 如果不是，通过上面所说的next取链接的下一个结点 因为是相对偏移，所以只要n+=nx即可得到连接的结点指针，再回到2
-        if (nx == 0) break;
-        n += nx;
-      }
-    }
-    return &absentkey;//不存在对应的key
+    // 这里是哈希部分，从主位置开始按组查找控制字节相同且key相等(同为整型且值相同)的节点
+    unsigned int i = hashint(t, key);
+    searchnode(t, i, ctrltag(l_castS2U(key)),
+               keyisinteger(n) && keyival(n) == key);
+    if (l_likely(!hasoldentries(t)))
+      return &absentkey;
+    return oldentry(luaH_getint(oldhashpart(t), key));
   }
 }
 
@@ -982,20 +2075,49 @@ const TValue *luaH_getint (Table *t, lua_Integer key) {
 /// @param key 
 /// @return 
 const TValue *luaH_getshortstr (Table *t, TString *key) {
-  Node *n = hashstr(t, key);//根据短字符串的散列值对散列表大小取余去获取对应的节点
   lua_assert(key->tt == LUA_VSHRSTR);//保证是短字符串类型
-  for (;;) {  /* check whether 'key' is somewhere in the chain */
-    if (keyisshrstr(n) && eqshrstr(keystrval(n), key))//判断是否为相同字符串,比较的是地址
+  if (t->shape != NULL) {  /* keys are in the shape? *///键在shape中
+    int k = shapeslot(t->shape, key);
+    return (k < 0) ? &absentkey : &t->fields[k];
+  }
+  else {
+    unsigned int i = hashstr(t, key);//根据短字符串的散列值对散列表大小取余去获取对应的节点
+    Node *n = gnode(t, i);
+    if (keyisshrstr(n) && eqshrstr(keystrval(n), key))  /* in main position? */
       return gval(n);  /* that's it */
-    else {
-      int nx = gnext(n);//获取Node n的next
-      if (nx == 0)
-        return &absentkey;  /* not found *///没找到
-      n += nx;//获取下一个Node在node hash表中索引值n
-    }
+    searchnode(t, i, ctrltag(key->hash),
+               keyisshrstr(n) && eqshrstr(keystrval(n), key));//判断是否为相同字符串,比较的是地址
+    if (l_likely(!hasoldentries(t)))
+      return &absentkey;
+    return oldentry(luaH_getshortstr(oldhashpart(t), key));
   }
 }
 
+
+/*
+** Search function for short strings used by inline caches: besides
+** returning the value, store in '*ic' the index of the node (or of the
+** field, for a table with a shape) holding 'key' (if any), so that
+** 'luaH_probeshortstr' finds it directly next time.
+*/
+
+/// @brief 从表t中查找短字符串为键的值,找到时把节点下标记录到内联缓存ic
+/// @param t 
+/// @param key 
+/// @param ic 
+/// @return 
+const TValue *luaH_getshortstric (Table *t, TString *key, unsigned int *ic) {
+  const TValue *slot = luaH_getshortstr(t, key);
+  icstat(luaH_icmisses);
+  if (isabstkey(slot))  /* not found? */
+    return slot;
+  else if (t->shape != NULL)
+    *ic = cast_uint(slot - t->fields);  /* remember field */
+  else if (!hasoldentries(t))  /* (slot may be in the old part otherwise) */
+    *ic = cast_uint(nodefromval(slot) - gnode(t, 0));  /* remember node */
+  return slot;
+}
+
 /// @brief 如果key是string就调用luaH_getstr
 /// @param t 
 /// @param key 
@@ -1006,7 +2128,7 @@ const TValue *luaH_getstr (Table *t, TString *key) {
   else {  /* for long strings, use generic case *///如果是长字符串
     TValue ko;
     setsvalue(cast(lua_State *, NULL), &ko, key);
-    return getgeneric(t, &ko, 0);//从表t的散列表部分查找键为key的值是否存在，存在则返回
+    return getgeneric(t, &ko);//从表t的散列表部分查找键为key的值是否存在，存在则返回
   }
 }
 
@@ -1031,7 +2153,7 @@ const TValue *luaH_get (Table *t, const TValue *key) {
       /* else... */
     }  /* FALLTHROUGH */
     default:
-      return getgeneric(t, key, 0);//从表t的散列表部分查找键为key的值是否存在，存在则返回
+      return getgeneric(t, key);//从表t的散列表部分查找键为key的值是否存在，存在则返回
   }
 }
 
@@ -1051,6 +2173,7 @@ const TValue *luaH_get (Table *t, const TValue *key) {
 /// @param value 
 void luaH_finishset (lua_State *L, Table *t, const TValue *key,
                                    const TValue *slot, TValue *value) {
+  luaH_checkwrite(L, t);
   if (isabstkey(slot))//找不到key
     luaH_newkey(L, t, key, value);//重新new一个
   else
@@ -1080,6 +2203,7 @@ void luaH_set (lua_State *L, Table *t, const TValue *key, TValue *value) {
 /// @param value 
 void luaH_setint (lua_State *L, Table *t, lua_Integer key, TValue *value) {
   const TValue *p = luaH_getint(t, key);//键已存在
+  luaH_checkwrite(L, t);
   if (isabstkey(p)) {//找不到
     TValue k;
     setivalue(&k, key);
@@ -1248,7 +2372,8 @@ lua_Unsigned luaH_getn (Table *t) {
 /* export these functions for the test library */
 
 Node *luaH_mainposition (const Table *t, const TValue *key) {
-  return mainpositionTV(t, key);
+  lu_byte tag;
+  return gnode(t, mainpositionTV(t, key, &tag));
 }
 
 int luaH_isdummy (const Table *t) { return isdummy(t); }
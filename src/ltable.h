@@ -18,7 +18,6 @@
 
 #define gnode(t,i)	(&(t)->node[i])//取表node中idx=i的Node值
 #define gval(n)		(&(n)->i_val)//提取Node中的val
-#define gnext(n)	((n)->u.next)//提取Node中的key的next
 
 
 /*
@@ -41,15 +40,147 @@
 #define allocsizenode(t)	(isdummy(t) ? 0 : sizenode(t))
 
 
+/*
+** Old hash part of a table being rehashed incrementally. 'h' keeps
+** only a hash part (the other fields are empty); its nodes before
+** 'next' were already moved to the table's own hash part. After the
+** last one is moved, the part is kept (for traversals) until the next
+** insertion frees it.
+*/
+typedef struct OldHash {
+  Table h;
+  unsigned int next;  /* next node to be moved *///下一个要迁移的节点下标
+} OldHash;
+
+
+/* the old hash part of 't' as a table, or NULL if there is none */
+//得到t的旧hash部分,没有时为NULL;用 for (p = t; p; p = oldhashpart(p)) 遍历所有hash部分
+#define oldhashpart(t)	((t)->oldhash ? &(t)->oldhash->h : NULL)
+
+/* true if 't' has an old hash part with entries not moved yet */
+//t是否有尚未迁移完的旧hash部分
+#define hasoldentries(t) \
+	((t)->oldhash != NULL && \
+	 (t)->oldhash->next < cast_uint(sizenode(&(t)->oldhash->h)))
+
+
 /* returns the Node, given the value of a table entry */
 // 返回table 元素
 #define nodefromval(v)	cast(Node *, (v))
 
 
+/*
+** Shapes. A table whose keys are all short strings, added one at a
+** time, does not need its own hash part: tables built by the same
+** sequence of keys share one immutable 'Shape' (the keys, in insertion
+** order, plus a small hash index over them) and keep only the values,
+** in 'fields'. Shapes form a tree rooted at 'g->rootshape' where each
+** child adds one key to its parent. The collector marks the shapes
+** of the tables and templates it traverses (see 'luaH_markshape'),
+** takes the others out of the tree in the atomic phase, and frees them
+** once the tables that may still point to them have been swept (see
+** 'luaH_sweepshapes').
+** A table goes back to a regular hash part when it gets any other kind
+** of key or grows beyond the shape limits (see 'LUAI_MAXSHAPES').
+** Removed keys keep their slots, as dead keys do in the hash part.
+*/
+typedef struct Shape {
+  struct Shape *parent;
+  struct Shape *child;  /* first shape that extends this one *///第一个子shape
+  struct Shape *sibling;  /* next shape that extends 'parent' *///下一个兄弟shape
+  int nkeys;  /* number of keys *///键的数量
+  lu_byte marked;  /* in use in this cycle (see 'luaH_markshape') *///本轮GC中是否在使用
+  lu_byte lsizeindex;  /* log2 of size of 'index' */
+  lu_byte *index;  /* open-addressing index: position in 'keys' + 1 *///键的开放寻址索引,存放键在keys中的位置+1
+  TString *keys[1];  /* keys, in insertion order *///按插入顺序存放的键
+} Shape;
+
+
+/* mark shape 's' as in use in the current cycle */
+//标记shape s在本轮GC中正在使用
+#define luaH_markshape(s) \
+	((s)->marked ? cast_void(0) : luaH_markancestors(s))
+
+
+/* number of values allocated in 'fields' for a shape with 'n' keys */
+//有n个键的shape对应的fields容量
+#define shapecap(n)	((n) == 0 ? 0 : (n) <= 4 ? 4 : twoto(luaO_ceillog2(n)))
+
+
+/*
+** Hash-size hint for a new table built by a constructor: small records
+** get their keys through shapes, so no hash part is preallocated.
+*/
+#define luaH_hashhint(n) \
+	((LUAI_MAXSHAPES > 0 && (n) <= LUAI_MAXSHAPEKEYS) ? 0 : (n))
+
+
+/*
+** Inline-cache probe for short-string key 'k': if the node (or, for a
+** table with a shape, the field) remembered in '*ic' still holds 'k',
+** return its value directly; otherwise do a regular search, which also
+** refreshes '*ic'. A cached index is never trusted without checking its
+** key, so resizes, rehashes, and removed keys only cost a miss.
+** Define LUAI_NOICACHE to do a regular search every time, and
+** LUAI_ICSTATS to count probes and misses (see etc/icbench.c).
+*/
+
+#if defined(LUAI_ICSTATS)
+LUAI_DDEC(lu_mem luaH_icprobes;)  /* probes, over all states */
+LUAI_DDEC(lu_mem luaH_icmisses;)  /* probes that had to search */
+#define icstat(c)	((c)++)
+#else
+#define icstat(c)	((void)0)
+#endif
+
+#if defined(LUAI_NOICACHE)
+#define luaH_probeshortstr(t,k,ic) \
+  (icstat(luaH_icprobes), icstat(luaH_icmisses), cast_void(ic), \
+   luaH_getshortstr(t, k))
+#else
+//内联缓存查找短字符串键:缓存的节点仍然是这个key就直接返回,否则正常查找并更新缓存
+#define luaH_probeshortstr(t,k,ic) \
+  (icstat(luaH_icprobes), \
+   (t)->shape != NULL \
+   ? (*(ic) < cast_uint((t)->shape->nkeys) && \
+      (t)->shape->keys[*(ic)] == (k) \
+        ? &(t)->fields[*(ic)] \
+        : luaH_getshortstric(t, k, ic)) \
+   : (keyisshrstr(gnode(t, lmod(*(ic), sizenode(t)))) && \
+      keystrval(gnode(t, lmod(*(ic), sizenode(t)))) == (k) \
+        ? gval(gnode(t, lmod(*(ic), sizenode(t)))) \
+        : luaH_getshortstric(t, k, ic)))
+#endif
+
+
+/*
+** Tables in some '__index' chain may have lookups stored in the cache
+** of such chains (see 'luaV_finishget'); every change to their keys,
+** values, or metatable must invalidate that cache.
+*/
+//修改属于__index链的表时让链缓存失效
+#define luaH_chainchange(g,t) \
+	{ if (l_unlikely(ischainmember(t))) luaH_invalidatechains(g); }
+
+
+/*
+** Changes made by a program (as opposed to the collector) to the keys,
+** values, or metatable of a table check it first: frozen tables raise
+** an error, and other tables in '__index' chains invalidate that cache.
+*/
+//程序修改表之前的检查:冻结的表报错,__index链上的表让链缓存失效
+#define luaH_checkwrite(L,t) \
+	{ if (l_unlikely(ischainmember(t))) luaH_writeguard(L, t); }
+
+#define isfrozen(t)	((t)->frozen)
+
+
 LUAI_FUNC const TValue *luaH_getint (Table *t, lua_Integer key);
 LUAI_FUNC void luaH_setint (lua_State *L, Table *t, lua_Integer key,
                                                     TValue *value);
 LUAI_FUNC const TValue *luaH_getshortstr (Table *t, TString *key);
+LUAI_FUNC const TValue *luaH_getshortstric (Table *t, TString *key,
+                                                      unsigned int *ic);
 LUAI_FUNC const TValue *luaH_getstr (Table *t, TString *key);
 LUAI_FUNC const TValue *luaH_get (Table *t, const TValue *key);
 LUAI_FUNC void luaH_newkey (lua_State *L, Table *t, const TValue *key,
@@ -62,10 +193,29 @@ LUAI_FUNC Table *luaH_new (lua_State *L);
 LUAI_FUNC void luaH_resize (lua_State *L, Table *t, unsigned int nasize,
                                                     unsigned int nhsize);
 LUAI_FUNC void luaH_resizearray (lua_State *L, Table *t, unsigned int nasize);
+LUAI_FUNC int luaH_compact (lua_State *L, Table *t);
+LUAI_FUNC int luaH_trimarray (lua_State *L, Table *t);
+LUAI_FUNC void luaH_finishmove (struct global_State *g, Table *t);
+LUAI_FUNC void luaH_clear (lua_State *L, Table *t);
+LUAI_FUNC int luaH_movearray (lua_State *L, Table *src, lua_Integer f,
+                              lua_Integer e, Table *dst, lua_Integer t);
 LUAI_FUNC void luaH_free (lua_State *L, Table *t);
 LUAI_FUNC int luaH_next (lua_State *L, Table *t, StkId key);
+LUAI_FUNC unsigned int luaH_nextpos (lua_State *L, Table *t, StkId key,
+                                                       unsigned int pos);
 LUAI_FUNC lua_Unsigned luaH_getn (Table *t);
 LUAI_FUNC unsigned int luaH_realasize (const Table *t);
+LUAI_FUNC Shape *luaH_templateshape (lua_State *L, TString *const *keys,
+                                                    int n);
+LUAI_FUNC void luaH_setshape (lua_State *L, Table *t, Shape *s,
+                                           const TValue *values);
+LUAI_FUNC void luaH_markancestors (Shape *s);
+LUAI_FUNC void luaH_unmarkshapes (struct global_State *g);
+LUAI_FUNC void luaH_sweepshapes (lua_State *L);
+LUAI_FUNC void luaH_freeshapes (lua_State *L);
+LUAI_FUNC void luaH_invalidatechains (struct global_State *g);
+LUAI_FUNC void luaH_writeguard (lua_State *L, Table *t);
+LUAI_FUNC void luaH_freeze (lua_State *L, Table *t);
 
 
 #if defined(LUA_DEBUG)
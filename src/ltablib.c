@@ -79,7 +79,15 @@ static int tinsert (lua_State *L) {
       /* check whether 'pos' is in [1, e] */
       luaL_argcheck(L, (lua_Unsigned)pos - 1u < (lua_Unsigned)e, 2,
                        "position out of bounds");
-      for (i = e; i > pos; i--) {  /* move up elements */
+      i = e;
+      if (i > pos) {  /* move last element first (it may grow the array) */
+        lua_geti(L, 1, i - 1);
+        lua_seti(L, 1, i);  /* t[i] = t[i - 1] */
+        i--;
+        if (lua_arraymove(L, 1, pos, i - 1, pos + 1, 1))  /* all others */
+          i = pos;  /* done */
+      }
+      for (; i > pos; i--) {  /* move up elements */
         lua_geti(L, 1, i - 1);
         lua_seti(L, 1, i);  /* t[i] = t[i - 1] */
       }
@@ -102,6 +110,8 @@ static int tremove (lua_State *L) {
     luaL_argcheck(L, (lua_Unsigned)pos - 1u <= (lua_Unsigned)size, 1,
                      "position out of bounds");
   lua_geti(L, 1, pos);  /* result = t[pos] */
+  if (pos < size && lua_arraymove(L, 1, pos + 1, size, pos, 1))
+    pos = size;  /* moved all elements at once */
   for ( ; pos < size; pos++) {
     lua_geti(L, 1, pos + 1);
     lua_seti(L, 1, pos);  /* t[pos] = t[pos + 1] */
@@ -132,7 +142,10 @@ static int tmove (lua_State *L) {
     n = e - f + 1;  /* number of elements to move */
     luaL_argcheck(L, t <= LUA_MAXINTEGER - n + 1, 4,
                   "destination wrap around");
-    if (t > e || t <= f || (tt != 1 && !lua_compare(L, 1, tt, LUA_OPEQ))) {
+    if (lua_arraymove(L, 1, f, e, t, tt))
+      ;  /* moved all elements at once */
+    else if (t > e || t <= f ||
+             (tt != 1 && !lua_compare(L, 1, tt, LUA_OPEQ))) {
       for (i = 0; i < n; i++) {
         lua_geti(L, 1, f + i);
         lua_seti(L, tt, t + i);
@@ -166,6 +179,8 @@ static int tconcat (lua_State *L) {
   const char *sep = luaL_optlstring(L, 2, "", &lsep);
   lua_Integer i = luaL_optinteger(L, 3, 1);
   last = luaL_optinteger(L, 4, last);
+  if (luaA_concattable(L, 1, i, last, sep, lsep))
+    return 1;  /* all elements were in the array part */
   luaL_buffinit(L, &b);
   for (; i < last; i++) {
     addfield(L, &b, i);
@@ -213,6 +228,62 @@ static int tunpack (lua_State *L) {
   return (int)n;
 }
 
+
+/*
+** table.compact(t): releases the slots that 't' does not need anymore
+** (after many removals); returns whether the table was resized.
+*/
+static int tcompact (lua_State *L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  lua_pushboolean(L, lua_compacttable(L, 1));
+  return 1;
+}
+
+
+/*
+** table.freeze(t): makes 't' read-only, so that any later change to it
+** raises an error; returns 't'.
+*/
+static int tfreeze (lua_State *L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  lua_settop(L, 1);
+  lua_freeze(L, 1);
+  return 1;
+}
+
+
+static int tisfrozen (lua_State *L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  lua_pushboolean(L, lua_isfrozen(L, 1));
+  return 1;
+}
+
+
+/*
+** table.new([narray [, nhash]]): creates a table with room for 'narray'
+** array elements and 'nhash' other fields.
+*/
+static int tnew (lua_State *L) {
+  lua_Integer na = luaL_optinteger(L, 1, 0);
+  lua_Integer nh = luaL_optinteger(L, 2, 0);
+  luaL_argcheck(L, 0 <= na && na <= INT_MAX, 1, "out of range");
+  luaL_argcheck(L, 0 <= nh && nh <= INT_MAX, 2, "out of range");
+  lua_createtable(L, (int)na, (int)nh);
+  return 1;
+}
+
+
+/*
+** table.clear(t): removes all elements of 't', keeping the memory it
+** already has for them; returns 't'.
+*/
+static int tclear (lua_State *L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  lua_settop(L, 1);
+  lua_cleartable(L, 1);
+  return 1;
+}
+
 /* }====================================================== */
 
 
@@ -408,12 +479,112 @@ static int sort (lua_State *L) {
     luaL_argcheck(L, n < INT_MAX, 1, "array too big");
     if (!lua_isnoneornil(L, 2))  /* is there a 2nd argument? */
       luaL_checktype(L, 2, LUA_TFUNCTION);  /* must be a function */
+    else if (luaA_sortarray(L, 1, n, 0))  /* plain strings or numbers? */
+      return 0;  /* sorted directly on the array */
     lua_settop(L, 2);  /* make sure there are two arguments */
     auxsort(L, 1, (IdxT)n, 0);
   }
   return 0;
 }
 
+
+/* }====================================================== */
+
+
+/*
+** {======================================================
+** Merge sort (stable)
+** =======================================================
+*/
+
+/* segments up to this size are sorted by insertion */
+#define MSORTCUTOFF	12
+
+
+/*
+** Stable insertion sort of a[lo..up]
+*/
+static void insertsort (lua_State *L, IdxT lo, IdxT up) {
+  IdxT i;
+  for (i = lo + 1; i <= up; i++) {
+    IdxT j = i;
+    lua_geti(L, 1, i);  /* V = a[i] */
+    /* while V < a[j - 1], move a[j - 1] up */
+    while (j > lo && ((void)lua_geti(L, 1, j - 1), sort_comp(L, -2, -1)))
+      lua_seti(L, 1, j--);
+    if (j > lo)
+      lua_pop(L, 1);  /* remove a[j - 1] (not greater than V) */
+    lua_seti(L, 1, j);  /* a[j] = V */
+  }
+}
+
+
+/*
+** Merge sort of a[lo..up], using the table at index 3 as a buffer for
+** the lower half of each merge. Taking equal elements from the lower
+** half first keeps the sort stable. (If the order function raises an
+** error in the middle of a merge, some elements of the array may be
+** left only in the buffer.)
+*/
+static void auxmerge (lua_State *L, IdxT lo, IdxT up) {
+  if (up - lo < MSORTCUTOFF)
+    insertsort(L, lo, up);
+  else {
+    IdxT mid = lo + (up - lo) / 2;
+    IdxT nl = mid - lo + 1;  /* size of lower half */
+    IdxT i = 1, j = mid + 1, k = lo;
+    auxmerge(L, lo, mid);
+    auxmerge(L, mid + 1, up);
+    lua_geti(L, 1, mid + 1);
+    lua_geti(L, 1, mid);
+    if (!sort_comp(L, -2, -1)) {  /* a[mid + 1] >= a[mid]? */
+      lua_pop(L, 2);
+      return;  /* halves already in order */
+    }
+    lua_pop(L, 2);
+    if (!lua_arraymove(L, 1, lo, mid, 1, 3)) {  /* buff[1..nl] = a[lo..mid] */
+      for (; i <= nl; i++) {
+        lua_geti(L, 1, lo + i - 1);
+        lua_seti(L, 3, i);
+      }
+      i = 1;
+    }
+    while (i <= nl && j <= up) {
+      lua_geti(L, 1, j);
+      lua_geti(L, 3, i);
+      if (sort_comp(L, -2, -1)) {  /* a[j] < buff[i]? */
+        lua_pop(L, 1);
+        j++;
+      }
+      else {
+        lua_remove(L, -2);
+        i++;
+      }
+      lua_seti(L, 1, k++);
+    }
+    for (; i <= nl; i++) {  /* rest of the lower half */
+      lua_geti(L, 3, i);
+      lua_seti(L, 1, k++);
+    }  /* rest of the upper half is already in place */
+  }
+}
+
+
+static int stablesort (lua_State *L) {
+  lua_Integer n = aux_getn(L, 1, TAB_RW);
+  if (n > 1) {  /* non-trivial interval? */
+    luaL_argcheck(L, n < INT_MAX, 1, "array too big");
+    if (!lua_isnoneornil(L, 2))  /* is there a 2nd argument? */
+      luaL_checktype(L, 2, LUA_TFUNCTION);  /* must be a function */
+    else if (luaA_sortarray(L, 1, n, 1))  /* plain strings or numbers? */
+      return 0;  /* sorted directly on the array */
+    lua_settop(L, 2);  /* make sure there are two arguments */
+    lua_createtable(L, (int)(n / 2 + 1), 0);  /* buffer for merges */
+    auxmerge(L, 1, (IdxT)n);
+  }
+  return 0;
+}
+
 /* }====================================================== */
 
 
@@ -425,6 +596,12 @@ static const luaL_Reg tab_funcs[] = {
   {"remove", tremove},
   {"move", tmove},
   {"sort", sort},
+  {"stablesort", stablesort},
+  {"compact", tcompact},
+  {"freeze", tfreeze},
+  {"isfrozen", tisfrozen},
+  {"new", tnew},
+  {"clear", tclear},
   {NULL, NULL}
 };
 
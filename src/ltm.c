@@ -116,8 +116,16 @@ const char *luaT_objtypename (lua_State *L, const TValue *o) {
   if ((ttistable(o) && (mt = hvalue(o)->metatable) != NULL) ||
       (ttisfulluserdata(o) && (mt = uvalue(o)->metatable) != NULL)) {
     const TValue *name = luaH_getshortstr(mt, luaS_new(L, "__name"));
-    if (ttisstring(name))  /* is '__name' a string? */
-      return getstr(tsvalue(name));  /* use it as type name */
+    if (ttisstring(name)) {  /* is '__name' a string? */
+      TString *ts = luaS_seal(L, tsvalue(name));
+      if (ts != tsvalue(name)) {  /* got a zero-terminated copy? */
+        /* anchor it; only error messages use this name, and errors
+           discard the stack (assume EXTRA_STACK) */
+        setsvalue2s(L, L->top, ts);
+        L->top++;
+      }
+      return getstr(ts);  /* use it as type name */
+    }
   }
   return ttypename(ttype(o));  /* else use standard type name */
 }
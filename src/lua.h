@@ -83,6 +83,19 @@ typedef struct lua_State lua_State;
 
 
 
+/*
+** element types of typed arrays
+*/
+#define LUA_AINT8	1
+#define LUA_AINT16	2
+#define LUA_AINT32	3
+#define LUA_AINT64	4
+#define LUA_AFLOAT32	5
+#define LUA_AFLOAT64	6
+
+#define LUA_NUMATYPES	6
+
+
 /* minimum Lua stack available to a C function */
 /// @brief 最小栈空间
 #define LUA_MINSTACK	20
@@ -287,6 +300,8 @@ LUA_API const char     *(lua_tolstring) (lua_State *L, int idx, size_t *len);
 LUA_API lua_Unsigned    (lua_rawlen) (lua_State *L, int idx);
 LUA_API lua_CFunction   (lua_tocfunction) (lua_State *L, int idx);
 LUA_API void	       *(lua_touserdata) (lua_State *L, int idx);
+LUA_API void	       *(lua_toarray) (lua_State *L, int idx, int *atype,
+                                                       size_t *n);
 LUA_API lua_State      *(lua_tothread) (lua_State *L, int idx);
 LUA_API const void     *(lua_topointer) (lua_State *L, int idx);
 //----------------------------------栈上指定元素转到对应的类型 end -------------------------------//
@@ -329,6 +344,10 @@ LUA_API void        (lua_pushnil) (lua_State *L);
 LUA_API void        (lua_pushnumber) (lua_State *L, lua_Number n);
 LUA_API void        (lua_pushinteger) (lua_State *L, lua_Integer n);
 LUA_API const char *(lua_pushlstring) (lua_State *L, const char *s, size_t len);
+LUA_API void        (lua_pushsubstring) (lua_State *L, int idx, size_t i,
+                                         size_t len);
+LUA_API const char *(lua_pushexternalstring) (lua_State *L, const char *s,
+                                size_t len, lua_Alloc falloc, void *ud);
 LUA_API const char *(lua_pushstring) (lua_State *L, const char *s);
 LUA_API const char *(lua_pushvfstring) (lua_State *L, const char *fmt,
                                                       va_list argp);
@@ -352,6 +371,7 @@ LUA_API int (lua_rawgetp) (lua_State *L, int idx, const void *p);
 
 LUA_API void  (lua_createtable) (lua_State *L, int narr, int nrec);
 LUA_API void *(lua_newuserdatauv) (lua_State *L, size_t sz, int nuvalue);
+LUA_API void *(lua_newarray) (lua_State *L, int atype, size_t n);
 LUA_API int   (lua_getmetatable) (lua_State *L, int objindex);
 LUA_API int  (lua_getiuservalue) (lua_State *L, int idx, int n);
 
@@ -425,6 +445,7 @@ LUA_API void (lua_warning)  (lua_State *L, const char *msg, int tocont);
 #define LUA_GCISRUNNING		9
 #define LUA_GCGEN		10
 #define LUA_GCINC		11
+#define LUA_GCSHRINK		12
 
 LUA_API int (lua_gc) (lua_State *L, int what, ...);
 
@@ -436,6 +457,12 @@ LUA_API int (lua_gc) (lua_State *L, int what, ...);
 LUA_API int   (lua_error) (lua_State *L);
 
 LUA_API int   (lua_next) (lua_State *L, int idx);
+LUA_API int   (lua_compacttable) (lua_State *L, int idx);
+LUA_API void  (lua_freeze) (lua_State *L, int idx);
+LUA_API int   (lua_isfrozen) (lua_State *L, int idx);
+LUA_API void  (lua_cleartable) (lua_State *L, int idx);
+LUA_API int   (lua_arraymove) (lua_State *L, int idx1, lua_Integer f,
+                               lua_Integer e, lua_Integer t, int idx2);
 
 LUA_API void  (lua_concat) (lua_State *L, int n);
 LUA_API void  (lua_len)    (lua_State *L, int idx);
@@ -624,6 +651,60 @@ struct lua_Debug {
 /* }====================================================================== */
 
 
+/*
+** {======================================================================
+** Hooks of the standard libraries into the core (implemented in lapi.c).
+** They are not part of the API: only the core and the libraries see
+** them (LUA_CORE or LUA_LIB), shared builds do not export them
+** (LUAI_FUNC), and they may change in any release.
+** =======================================================================
+*/
+#if defined(LUA_CORE) || defined(LUA_LIB)
+
+/*
+** Declare 'nextf' as the primitive 'next' and return the previous one.
+** A generic 'for' whose iterator is 'nextf' traverses its table in
+** place and never calls 'nextf', so 'nextf' must behave exactly as
+** 'next' of the base library (which is the only function given here).
+*/
+/// @brief 设置原始next函数,通用for循环用它遍历表时VM直接在表上遍历,不会调用它
+/// @param  
+/// @return 之前设置的函数
+LUAI_FUNC lua_CFunction (luaA_setnextf) (lua_State *L, lua_CFunction nextf);
+
+/*
+** Sort t[1..n] of the table at 'idx' as 'table.sort' without an order
+** function would, keeping equal elements in order when 'stable' is
+** true, and return 1. Return 0 without touching the table when n < 1,
+** when some of these elements is outside the array part, or when they
+** are not all numbers or all strings; the caller must then sort them
+** itself. Raise "attempt to modify a frozen table" if it would sort a
+** frozen table. Does not change the stack.
+*/
+/// @brief idx处的表的t[1..n]都在数组部分并且全是字符串或全是数字时直接排序并返回1,否则什么也不做,返回0
+/// @param  
+/// @return 
+LUAI_FUNC int (luaA_sortarray) (lua_State *L, int idx, lua_Integer n,
+                                int stable);
+
+/*
+** Push t[i] .. sep .. ... .. t[j], with 't' the table at 'idx', and
+** return 1 (an empty string when i > j). Return 0 without pushing
+** anything when 't' is not a table, when some of these elements is
+** outside the array part, or when they are not all strings or numbers;
+** the caller must then build the result itself (and complain about bad
+** values). Raise "string length overflow" if the result is too long.
+*/
+/// @brief 把idx处的表的t[i]..sep..t[j]连接后的结果放到栈顶并返回1;表中这些元素不都是数组部分中的字符串或数字时什么也不做,返回0
+/// @param  
+/// @return 
+LUAI_FUNC int (luaA_concattable) (lua_State *L, int idx, lua_Integer i,
+                                  lua_Integer j, const char *sep, size_t lsep);
+
+#endif
+/* }====================================================================== */
+
+
 /******************************************************************************
 * Copyright (C) 1994-2022 Lua.org, PUC-Rio.
 *
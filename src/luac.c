@@ -33,11 +33,14 @@
 
 static void PrintFunction(const Proto* f, int full);
 #define luaU_print	PrintFunction
+static void CountPairs(const Proto* f);
+static void PrintPairs(void);
 
 #define PROGNAME	"luac"		/* default program name */
 #define OUTPUT		PROGNAME ".out"	/* default output file */
 
 static int listing=0;			/* list bytecodes? */
+static int pairing=0;			/* report opcode pair frequencies? */
 static int dumping=1;			/* dump bytecodes? */
 static int stripping=0;			/* strip debug information? */
 static char Output[]={ OUTPUT };	/* default output file name */
@@ -68,6 +71,7 @@ static void usage(const char* message)
   "Available options are:\n"
   "  -l       list (use -l -l for full listing)\n"
   "  -o name  output to file 'name' (default is \"%s\")\n"
+  "  -P       report frequencies of adjacent opcode pairs\n"
   "  -p       parse only\n"
   "  -s       strip debug information\n"
   "  -v       show version information\n"
@@ -107,6 +111,8 @@ static int doargs(int argc, char* argv[])
   }
   else if (IS("-p"))			/* parse only */
    dumping=0;
+  else if (IS("-P"))			/* opcode pair frequencies */
+   pairing=1;
   else if (IS("-s"))			/* strip debug information */
    stripping=1;
   else if (IS("-v"))			/* show version */
@@ -114,7 +120,7 @@ static int doargs(int argc, char* argv[])
   else					/* unknown option */
    usage(argv[i]);
  }
- if (i==argc && (listing || !dumping))
+ if (i==argc && (listing || pairing || !dumping))
  {
   dumping=0;
   argv[--i]=Output;
@@ -162,6 +168,7 @@ static const Proto* combine(lua_State* L, int n)
    if (f->p[i]->sizeupvalues>0) f->p[i]->upvalues[0].instack=0;
   }
   luaM_freearray(L,f->lineinfo,f->sizelineinfo);
+  f->lineinfo=NULL;
   f->sizelineinfo=0;
   return f;
  }
@@ -188,6 +195,7 @@ static int pmain(lua_State* L)
  }
  f=combine(L,argc);
  if (listing) luaU_print(f,listing>1);
+ if (pairing) { CountPairs(f); PrintPairs(); }
  if (dumping)
  {
   FILE* D= (output==NULL) ? stdout : fopen(output,"wb");
@@ -346,7 +354,7 @@ static void PrintCode(const Proto* f)
  for (pc=0; pc<n; pc++)
  {
   Instruction i=code[pc];
-  OpCode o=GET_OPCODE(i);
+  OpCode o=GET_BASEOPCODE(i);
   int a=GETARG_A(i);
   int b=GETARG_B(i);
   int c=GETARG_C(i);
@@ -663,6 +671,9 @@ static void PrintCode(const Proto* f)
 	printf("%d %d %d",a,b,c);
 	printf(COMMENT "not handled");
 	break;
+#else
+   default:	/* internal opcodes are listed as their original ones */
+	break;
 #endif
   }
   printf("\n");
@@ -729,3 +740,37 @@ static void PrintFunction(const Proto* f, int full)
  if (full) PrintDebug(f);
  for (i=0; i<n; i++) PrintFunction(f->p[i],full);
 }
+
+/*
+** opcode pair frequencies
+*/
+
+static unsigned long pairs[NUM_BASEOPCODES][NUM_BASEOPCODES];
+
+static void CountPairs(const Proto* f)
+{
+ int pc,n=f->sizecode;
+ for (pc=1; pc<n; pc++)
+  pairs[GET_BASEOPCODE(f->code[pc-1])][GET_BASEOPCODE(f->code[pc])]++;
+ for (pc=0; pc<f->sizep; pc++) CountPairs(f->p[pc]);
+}
+
+static void PrintPairs(void)
+{
+ unsigned long total=0;
+ int a,b;
+ for (a=0; a<NUM_BASEOPCODES; a++)
+  for (b=0; b<NUM_BASEOPCODES; b++) total+=pairs[a][b];
+ printf("%lu opcode pairs\n",total);
+ for (;;)				/* print pairs by decreasing frequency */
+ {
+  unsigned long max=0;
+  int ma=0,mb=0;
+  for (a=0; a<NUM_BASEOPCODES; a++)
+   for (b=0; b<NUM_BASEOPCODES; b++)
+    if (pairs[a][b]>max) { max=pairs[a][b]; ma=a; mb=b; }
+  if (max==0) break;
+  printf("%8lu\t%5.2f%%\t%-9s\t%s\n",max,100.0*max/total,opnames[ma],opnames[mb]);
+  pairs[ma][mb]=0;
+ }
+}
@@ -41,6 +41,9 @@ LUAMOD_API int (luaopen_string) (lua_State *L);
 #define LUA_UTF8LIBNAME	"utf8"
 LUAMOD_API int (luaopen_utf8) (lua_State *L);
 
+#define LUA_ARRAYLIBNAME	"array"
+LUAMOD_API int (luaopen_array) (lua_State *L);
+
 #define LUA_MATHLIBNAME	"math"
 LUAMOD_API int (luaopen_math) (lua_State *L);
 
@@ -152,6 +152,7 @@ static void loadCode (LoadState *S, Proto *f) {
   f->code = luaM_newvectorchecked(S->L, n, Instruction);
   f->sizecode = n;
   loadVector(S, f->code, n);
+  luaF_initcache(S->L, f);
 }
 
 
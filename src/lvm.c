@@ -28,6 +28,7 @@
 #include "ldo.h"
 #include "lfunc.h"
 #include "lgc.h"
+#include "lmem.h"
 #include "lobject.h"
 #include "lopcodes.h"
 #include "lstate.h"
@@ -97,8 +98,16 @@ static int l_strton (const TValue *obj, TValue *result) {
   lua_assert(obj != result);
   if (!cvt2num(obj))  /* is object not a string? */
     return 0;
-  else
-    return (luaO_str2num(svalue(obj), result) == vslen(obj) + 1);
+  else {
+    char *s = svalue(obj);
+    size_t len = vslen(obj);
+    char c;
+    int res;
+    luaS_closestr(s, len, c);
+    res = (luaO_str2num(s, result) == len + 1);
+    luaS_reopenstr(s, len, c);
+    return res;
+  }
 }
 
 
@@ -285,6 +294,49 @@ static int floatforloop (StkId ra) {
 }
 
 
+/*
+** Look up the short string 'key' through an '__index' chain that only
+** goes through tables, starting at metatable 'mt', using the cache of
+** such chains. Every table visited is marked as a chain member, so
+** that any later change to it invalidates the cache (see
+** 'luaH_chainchange'). Only successful lookups are cached. Returns NULL
+** if the chain does not find the key or goes through a function.
+*/
+
+/// @brief 通过只由表组成的__index链查找短字符串key,并使用链缓存
+/// @param L 
+/// @param mt 链开始的元表
+/// @param key 
+/// @return 找到的值,找不到或链中有函数时返回NULL
+static const TValue *chainget (lua_State *L, Table *mt, TString *key) {
+  global_State *g = G(L);
+  IndexCache *c = &g->idxcache[lmod(point2uint(mt) ^ key->hash,
+                                    INDEXCACHE_N)];
+  Table *h = mt;
+  int loop;
+  if (c->mt == mt && c->key == key && c->version == g->idxversion &&
+      !isempty(c->slot))  /* cache hit? */
+    return c->slot;
+  for (loop = 0; loop < MAXTAGLOOP; loop++) {
+    const TValue *tm = fasttm(L, h, TM_INDEX);
+    const TValue *res;
+    if (tm == NULL || !ttistable(tm))
+      return NULL;  /* no metamethod or not a table */
+    setchainmember(h);
+    setchainmember(hvalue(tm));
+    res = luaH_getshortstr(hvalue(tm), key);
+    if (!isempty(res)) {  /* found? */
+      c->mt = mt; c->key = key; c->slot = res; c->version = g->idxversion;
+      return res;
+    }
+    h = hvalue(tm)->metatable;
+    if (h == NULL)
+      return NULL;
+  }
+  return NULL;  /* let 'luaV_finishget' raise the error */
+}
+
+
 /*
 ** Finish the table access 'val = t[key]'.
 ** if 'slot' is NULL, 't' is not a table; otherwise, 'slot' points to
@@ -301,9 +353,27 @@ void luaV_finishget (lua_State *L, const TValue *t, TValue *key, StkId val,
                       const TValue *slot) {
   int loop;  /* counter to avoid infinite loops 弄一个计数器避免进入死循环*/
   const TValue *tm;  /* metamethod 元方法*/
+  if (ttisshrstring(key)) {  /* try the cache of '__index' chains */
+    Table *mt;
+    switch (ttype(t)) {
+      case LUA_TTABLE: mt = hvalue(t)->metatable; break;
+      case LUA_TUSERDATA: mt = uvalue(t)->metatable; break;
+      default: mt = G(L)->mt[ttype(t)];
+    }
+    if (mt != NULL && (tm = chainget(L, mt, tsvalue(key))) != NULL) {
+      setobj2s(L, val, tm);
+      return;
+    }
+  }
   for (loop = 0; loop < MAXTAGLOOP; loop++) {
     if (slot == NULL) {  /* 't' is not a table? t不是table*/
+      lua_Integer k;
       lua_assert(!ttistable(t));
+      if (ttisarray(t) && luaV_tointegerns(key, &k, F2Ieq)) {  /* typed array? */
+        if (!luaV_arrayget(uvalue(t), k, s2v(val)))
+          setnilvalue(s2v(val));  /* out of bounds; result is nil */
+        return;
+      }
       tm = luaT_gettmbyobj(L, t, TM_INDEX);//获取元方法
       if (l_unlikely(notm(tm)))//没有设置index元方法
         luaG_typeerror(L, t, "index");  /* no metamethod 报错*/
@@ -333,6 +403,137 @@ void luaV_finishget (lua_State *L, const TValue *t, TValue *key, StkId val,
 }
 
 
+/*
+** {==================================================================
+** Typed arrays
+** ===================================================================
+*/
+
+/* log2 of the element size for each array type (indexed by 'atype') */
+LUAI_DDEF const lu_byte luaV_arraylsize[LUA_NUMATYPES + 1] = {
+  0,  /* not a typed array */
+  0, 1, 2, 3,  /* LUA_AINT8, LUA_AINT16, LUA_AINT32, LUA_AINT64 */
+  2, 3  /* LUA_AFLOAT32, LUA_AFLOAT64 */
+};
+
+
+/// @brief 读取类型化数组u的第k个元素到res,越界返回0
+/// @param u 
+/// @param k 
+/// @param res 
+/// @return 
+l_sinline int arrayget (Udata *u, lua_Integer k, TValue *res) {
+  void *p = getudatamem(u);
+  if (l_castS2U(k) - 1u >= luaV_arraylen(u))  /* out of bounds? */
+    return 0;
+  k--;
+  switch (u->atype) {
+    case LUA_AINT8: setivalue(res, cast(signed char *, p)[k]); break;
+    case LUA_AINT16: setivalue(res, cast(short *, p)[k]); break;
+    case LUA_AINT32: setivalue(res, cast(l_int32 *, p)[k]); break;
+    case LUA_AINT64:
+      setivalue(res, cast(lua_Integer, cast(long long *, p)[k])); break;
+    case LUA_AFLOAT32: setfltvalue(res, cast_num(cast(float *, p)[k])); break;
+    default: lua_assert(u->atype == LUA_AFLOAT64);
+      setfltvalue(res, cast_num(cast(double *, p)[k])); break;
+  }
+  return 1;
+}
+
+
+/*
+** Store 'v' as element 'k' of typed array 'u'. Integer elements get
+** the integer value of 'v'; float elements get its float value. Return
+** 0 (and store nothing) if 'k' is out of bounds or if 'v' is not a
+** number (with an integral value that fits in the element, for integer
+** elements). Integers are never truncated.
+*/
+
+/* does integer 'n' fit in a signed element whose maximum is 'm'? */
+#define arrayfits(n,m)	((n) >= -(m) - 1 && (n) <= (m))
+
+/// @brief 把v保存为类型化数组u的第k个元素,不能保存时(包括整数超出元素范围)返回0
+/// @param u 
+/// @param k 
+/// @param v 
+/// @return 
+l_sinline int arrayset (Udata *u, lua_Integer k, const TValue *v) {
+  void *p = getudatamem(u);
+  if (l_castS2U(k) - 1u >= luaV_arraylen(u))  /* out of bounds? */
+    return 0;
+  k--;
+  if (u->atype >= LUA_AFLOAT32) {  /* float elements? */
+    lua_Number n;
+    if (!tonumberns(v, n))
+      return 0;
+    if (u->atype == LUA_AFLOAT32)
+      cast(float *, p)[k] = cast(float, n);
+    else
+      cast(double *, p)[k] = cast(double, n);
+  }
+  else {
+    lua_Integer n;
+    if (!tointegerns(v, &n))
+      return 0;
+    switch (u->atype) {
+      case LUA_AINT8:
+        if (!arrayfits(n, 0x7f)) return 0;
+        cast(signed char *, p)[k] = cast(signed char, n); break;
+      case LUA_AINT16:
+        if (!arrayfits(n, 0x7fff)) return 0;
+        cast(short *, p)[k] = cast(short, n); break;
+      case LUA_AINT32:
+        if (!arrayfits(n, 0x7fffffff)) return 0;
+        cast(l_int32 *, p)[k] = cast(l_int32, n); break;
+      default: lua_assert(u->atype == LUA_AINT64);
+        cast(long long *, p)[k] = cast(long long, n); break;
+    }
+  }
+  return 1;
+}
+
+
+int luaV_arrayget (Udata *u, lua_Integer k, TValue *res) {
+  return arrayget(u, k, res);
+}
+
+
+int luaV_arrayset (Udata *u, lua_Integer k, const TValue *v) {
+  return arrayset(u, k, v);
+}
+
+
+/*
+** Fast track for typed arrays in the interpreter: if 't' is a typed
+** array and 'k' is inside its bounds, 'fastgetarray' copies 't[k]' into
+** 'res' and 'fastsetarray' stores 'v' into 't[k]'. Both return 0
+** otherwise (the set also fails if 'v' is not a number that fits the
+** elements). They never raise errors or allocate memory.
+*/
+#define fastgetarray(t,k,res)	(ttisarray(t) && arrayget(uvalue(t), k, res))
+
+#define fastsetarray(t,k,v)	(ttisarray(t) && arrayset(uvalue(t), k, v))
+
+
+/*
+** Raise the error for a failed 'luaV_arrayset'.
+*/
+static l_noret arrayseterror (lua_State *L, Udata *u, lua_Integer k,
+                                            const TValue *v) {
+  lua_Integer n;
+  if (l_castS2U(k) - 1u >= luaV_arraylen(u))
+    luaG_runerror(L, "typed array index %I out of bounds", k);
+  else if (tointegerns(v, &n))  /* integer too large for the element? */
+    luaG_runerror(L, "value %I out of range for typed array element", n);
+  else if (ttisnumber(v))  /* integer element from a non-integral float */
+    luaG_tointerror(L, v, v);
+  else
+    luaG_typeerror(L, v, "store in a typed array");
+}
+
+/* }================================================================== */
+
+
 /*
 ** Finish a table assignment 't[key] = val'.
 ** If 'slot' is NULL, 't' is not a table.  Otherwise, 'slot' points
@@ -365,6 +566,12 @@ void luaV_finishset (lua_State *L, const TValue *t, TValue *key,
       /* else will try the metamethod */
     }
     else {  /* not a table; check metamethod */
+      lua_Integer k;
+      if (ttisarray(t) && luaV_tointegerns(key, &k, F2Ieq)) {  /* typed array? */
+        if (l_unlikely(!luaV_arrayset(uvalue(t), k, val)))
+          arrayseterror(L, uvalue(t), k, val);
+        return;
+      }
       tm = luaT_gettmbyobj(L, t, TM_NEWINDEX);//查找元方法
       if (l_unlikely(notm(tm)))
         luaG_typeerror(L, t, "index");
@@ -386,17 +593,13 @@ void luaV_finishset (lua_State *L, const TValue *t, TValue *key,
 
 
 /*
-** Compare two strings 'ls' x 'rs', returning an integer less-equal-
-** -greater than zero if 'ls' is less-equal-greater than 'rs'.
-** The code is a little tricky because it allows '\0' in the strings
+** Compare two strings 'l' x 'r' (with lengths 'll' and 'lr'), returning
+** an integer less-equal-greater than zero if 'l' is less-equal-greater
+** than 'r'. The code is a little tricky because it allows '\0' in the strings
 ** and it uses 'strcoll' (to respect locales) for each segments
 ** of the strings.
 */
-static int l_strcmp (const TString *ls, const TString *rs) {
-  const char *l = getstr(ls);
-  size_t ll = tsslen(ls);
-  const char *r = getstr(rs);
-  size_t lr = tsslen(rs);
+static int strcmpaux (const char *l, size_t ll, const char *r, size_t lr) {
   for (;;) {  /* for each segment */
     int temp = strcoll(l, r);
     if (temp != 0)  /* not equal? */
@@ -415,6 +618,32 @@ static int l_strcmp (const TString *ls, const TString *rs) {
 }
 
 
+/*
+** Compare two strings 'ls' x 'rs', which may be open. Strings starting
+** at the same address are prefixes of one another, so their lengths
+** decide; other strings cannot overlap unless both are zero-terminated
+** (see 'separate').
+*/
+static int l_strcmp (const TString *ls, const TString *rs) {
+  char *l = getstr(ls);
+  size_t ll = tsslen(ls);
+  char *r = getstr(rs);
+  size_t lr = tsslen(rs);
+  if (l == r)  /* same buffer? */
+    return (ll == lr) ? 0 : (ll < lr) ? -1 : 1;
+  else {
+    char cl, cr;
+    int res;
+    luaS_closestr(l, ll, cl);
+    luaS_closestr(r, lr, cr);
+    res = strcmpaux(l, ll, r, lr);
+    luaS_reopenstr(r, lr, cr);
+    luaS_reopenstr(l, ll, cl);
+    return res;
+  }
+}
+
+
 /*
 ** Check whether integer 'i' is less than float 'f'. If 'i' has an
 ** exact representation as a float ('l_intfitsf'), compare numbers as
@@ -534,13 +763,32 @@ l_sinline int LEnum (const TValue *l, const TValue *r) {
 }
 
 
+/*
+** A slice may overlap the other string of a comparison, so that the
+** temporary '\0' of one would change the other (see 'l_strcmp'); then
+** the slice gets its own copy of its bytes. (Other strings overlap
+** only if they are external strings, which are zero-terminated and
+** so get no temporary '\0'.)
+*/
+static void separate (lua_State *L, TString *ls, TString *rs) {
+  if (issubstr(ls) || issubstr(rs)) {
+    const char *l = getstr(ls);
+    const char *r = getstr(rs);
+    if (l != r && l <= r + tsslen(rs) && r <= l + tsslen(ls))  /* overlap? */
+      luaS_unshare(L, issubstr(ls) ? ls : rs);
+  }
+}
+
+
 /*
 ** return 'l < r' for non-numbers.
 */
 static int lessthanothers (lua_State *L, const TValue *l, const TValue *r) {
   lua_assert(!ttisnumber(l) || !ttisnumber(r));
-  if (ttisstring(l) && ttisstring(r))  /* both are strings? */
+  if (ttisstring(l) && ttisstring(r)) {  /* both are strings? */
+    separate(L, tsvalue(l), tsvalue(r));
     return l_strcmp(tsvalue(l), tsvalue(r)) < 0;
+  }
   else
     return luaT_callorderTM(L, l, r, TM_LT);
 }
@@ -561,8 +809,10 @@ int luaV_lessthan (lua_State *L, const TValue *l, const TValue *r) {
 */
 static int lessequalothers (lua_State *L, const TValue *l, const TValue *r) {
   lua_assert(!ttisnumber(l) || !ttisnumber(r));
-  if (ttisstring(l) && ttisstring(r))  /* both are strings? */
+  if (ttisstring(l) && ttisstring(r)) {  /* both are strings? */
+    separate(L, tsvalue(l), tsvalue(r));
     return l_strcmp(tsvalue(l), tsvalue(r)) <= 0;
+  }
   else
     return luaT_callorderTM(L, l, r, TM_LE);
 }
@@ -686,8 +936,12 @@ void luaV_concat (lua_State *L, int total) {
         ts = luaS_newlstr(L, buff, tl);
       }
       else {  /* long string; copy strings directly to final result */
-        ts = luaS_createlngstrobj(L, tl);
-        copy2buff(top, n, getstr(ts));
+        int inplace;
+        ts = luaS_newcat(L, tsvalue(s2v(top - n)), tl, &inplace);
+        if (inplace)  /* first string already there? */
+          copy2buff(top, n - 1, getlngstr(ts) + vslen(s2v(top - n)));
+        else
+          copy2buff(top, n, getlngstr(ts));
       }
       setsvalue2s(L, top - n, ts);  /* create result */
     }
@@ -697,6 +951,293 @@ void luaV_concat (lua_State *L, int total) {
 }
 
 
+/* length of array element 'o' as a string; numbers are formatted into
+   'buff' (which must have room for MAXNUMBER2STR chars) */
+#define elemlen(o,buff)  \
+	(ttisstring(o) ? tsslen(tsvalue(o)) : cast_sizet(luaO_tostringbuff(o, buff)))
+
+
+/* copy elements t[i..j] of the array part of 't', with 'sep' between
+   them, to buffer 'buff' */
+static void copyelems (Table *t, lua_Integer i, lua_Integer j,
+                       const char *sep, size_t lsep, char *buff) {
+  char nbuff[MAXNUMBER2STR];  /* scratch buffer for numbers */
+  size_t tl = 0;  /* size already copied */
+  for (;;) {
+    const TValue *o = &t->array[i - 1];
+    size_t l = elemlen(o, nbuff);
+    memcpy(buff + tl, ttisstring(o) ? getstr(tsvalue(o)) : nbuff,
+           l * sizeof(char));
+    tl += l;
+    if (i++ == j) break;
+    memcpy(buff + tl, sep, lsep * sizeof(char));
+    tl += lsep;
+  }
+}
+
+
+/*
+** Concatenation for 'table.concat': build t[i] .. sep .. ... .. t[j],
+** if all these elements are strings or numbers in the array part of
+** 't'; otherwise, return NULL. A first pass computes the length of the
+** result, which is then created once and filled by a second pass.
+*/
+
+/// @brief 数组部分中t[i..j]都是字符串或数字时,一次分配结果字符串并把它们用sep连接起来;否则返回NULL
+/// @param L 
+/// @param t 
+/// @param i 
+/// @param j 
+/// @param sep 
+/// @param lsep 
+/// @return 
+TString *luaV_concattable (lua_State *L, Table *t, lua_Integer i,
+                           lua_Integer j, const char *sep, size_t lsep) {
+  char nbuff[MAXNUMBER2STR];
+  size_t tl = 0;
+  lua_Integer k;
+  TString *ts;
+  if (i > j)  /* empty interval? */
+    return luaS_newlstr(L, "", 0);
+  else if (i < 1 || j > cast(lua_Integer, luaH_realasize(t)))
+    return NULL;  /* some element outside the array part */
+  for (k = i; k <= j; k++) {  /* collect total length */
+    const TValue *o = &t->array[k - 1];
+    size_t l;
+    if (!(ttisstring(o) || cvt2str(o)))
+      return NULL;  /* let the caller handle (or complain about) it */
+    l = elemlen(o, nbuff);
+    if (k < j)  /* separator after it (saturating, to catch overflows) */
+      l = (lsep < MAX_SIZE - l) ? l + lsep : MAX_SIZE;
+    if (l_unlikely(l >= (MAX_SIZE/sizeof(char)) - tl))
+      luaG_runerror(L, "string length overflow");
+    tl += l;
+  }
+  if (tl <= LUAI_MAXSHORTLEN) {  /* is result a short string? */
+    char buff[LUAI_MAXSHORTLEN];
+    copyelems(t, i, j, sep, lsep, buff);
+    ts = luaS_newlstr(L, buff, tl);
+  }
+  else {  /* long string; copy elements directly to final result */
+    ts = luaS_createlngstrobj(L, tl);
+    copyelems(t, i, j, sep, lsep, getstr(ts));
+  }
+  return ts;
+}
+
+
+/*
+** {==================================================================
+** Sorting of homogeneous arrays (for 'table.sort' and
+** 'table.stablesort' without an order function)
+** ===================================================================
+*/
+
+/* kinds of homogeneous arrays */
+#define SORTINT		0	/* only integers */
+#define SORTFLT		1	/* only floats (no NaN) */
+#define SORTNUM		2	/* integers and floats (no NaN) */
+#define SORTSTR		3	/* only strings */
+
+/* segments up to this size are sorted by insertion */
+#define SORTCUTOFF	16
+
+
+/* primitive 'l < r' for values of the given kind */
+l_sinline int sortlt (int kind, const TValue *l, const TValue *r) {
+  switch (kind) {
+    case SORTINT: return ivalue(l) < ivalue(r);
+    case SORTFLT: return luai_numlt(fltvalue(l), fltvalue(r));
+    case SORTNUM: return LTnum(l, r);
+    default: return l_strcmp(tsvalue(l), tsvalue(r)) < 0;
+  }
+}
+
+
+/*
+** Kind of the values in a[0..n-1], or -1 if they are not all strings
+** or all numbers. NaNs are rejected, as they have no order.
+*/
+static int sortkind (const TValue *a, unsigned int n) {
+  unsigned int i;
+  int nint = 0, nflt = 0;
+  if (ttisstring(&a[0])) {
+    for (i = 0; i < n; i++) {  /* slices may need copies to be compared */
+      if (!ttisstring(&a[i]) || issubstr(tsvalue(&a[i])))
+        return -1;
+    }
+    return SORTSTR;
+  }
+  for (i = 0; i < n; i++) {
+    if (ttisinteger(&a[i]))
+      nint = 1;
+    else if (ttisfloat(&a[i]) && !luai_numisnan(fltvalue(&a[i])))
+      nflt = 1;
+    else
+      return -1;
+  }
+  return (nflt == 0) ? SORTINT : (nint == 0) ? SORTFLT : SORTNUM;
+}
+
+
+/* stable insertion sort of a[0..n-1] */
+static void insertsort (TValue *a, unsigned int n, int kind) {
+  unsigned int i, j;
+  for (i = 1; i < n; i++) {
+    TValue v = a[i];
+    for (j = i; j > 0 && sortlt(kind, &v, &a[j - 1]); j--)
+      a[j] = a[j - 1];
+    a[j] = v;
+  }
+}
+
+
+static void siftdown (TValue *a, unsigned int i, unsigned int n, int kind) {
+  TValue v = a[i];
+  for (;;) {
+    unsigned int c = 2 * i + 1;  /* first child */
+    if (c >= n)
+      break;
+    if (c + 1 < n && sortlt(kind, &a[c], &a[c + 1]))
+      c++;  /* take the larger child */
+    if (!sortlt(kind, &v, &a[c]))
+      break;
+    a[i] = a[c];
+    i = c;
+  }
+  a[i] = v;
+}
+
+
+static void heapsort (TValue *a, unsigned int n, int kind) {
+  unsigned int i;
+  for (i = n / 2; i-- > 0; )
+    siftdown(a, i, n, kind);
+  for (i = n - 1; i > 0; i--) {
+    TValue v = a[0]; a[0] = a[i]; a[i] = v;
+    siftdown(a, 0, i, kind);
+  }
+}
+
+
+#define sortswap(a,i,j)	{ TValue v_ = a[i]; a[i] = a[j]; a[j] = v_; }
+
+/*
+** Introsort: quicksort with a median-of-three pivot, finishing small
+** segments by insertion and switching to heapsort when the recursion
+** gets deeper than 'depth' (bad pivots).
+*/
+static void introsort (TValue *a, unsigned int n, int kind, int depth) {
+  while (n > SORTCUTOFF) {
+    unsigned int m = n / 2;
+    unsigned int i = 0;
+    unsigned int j = n - 1;
+    TValue p;
+    if (depth-- == 0) {  /* too many bad partitions? */
+      heapsort(a, n, kind);
+      return;
+    }
+    /* sort a[0], a[m], and a[n - 1] */
+    if (sortlt(kind, &a[m], &a[0])) sortswap(a, 0, m);
+    if (sortlt(kind, &a[n - 1], &a[m])) {
+      sortswap(a, m, n - 1);
+      if (sortlt(kind, &a[m], &a[0])) sortswap(a, 0, m);
+    }
+    p = a[m];
+    /* a[0] <= P <= a[n - 1] act as sentinels for the inner loops */
+    for (;;) {
+      while (sortlt(kind, &a[++i], &p)) {}
+      while (sortlt(kind, &p, &a[--j])) {}
+      if (i >= j)
+        break;
+      sortswap(a, i, j);
+    }
+    /* a[0 .. i - 1] <= P <= a[i .. n - 1] */
+    if (i < n - i) {  /* lower part is smaller? */
+      introsort(a, i, kind, depth);
+      a += i; n -= i;
+    }
+    else {
+      introsort(a + i, n - i, kind, depth);
+      n = i;
+    }
+  }
+  insertsort(a, n, kind);
+}
+
+
+/*
+** Stable merge sort of a[0..n-1]; 'buff' must have room for n/2
+** values.
+*/
+static void mergesort (TValue *a, unsigned int n, TValue *buff, int kind) {
+  if (n <= SORTCUTOFF)
+    insertsort(a, n, kind);
+  else {
+    unsigned int nl = n / 2;
+    unsigned int i = 0, j = nl, k = 0;
+    mergesort(a, nl, buff, kind);
+    mergesort(a + nl, n - nl, buff, kind);
+    if (!sortlt(kind, &a[nl], &a[nl - 1]))
+      return;  /* halves already in order */
+    memcpy(buff, a, nl * sizeof(TValue));
+    while (i < nl && j < n) {  /* 'k < j' always holds */
+      if (sortlt(kind, &a[j], &buff[i]))
+        a[k++] = a[j++];
+      else  /* equal elements come from the left half first */
+        a[k++] = buff[i++];
+    }
+    while (i < nl)
+      a[k++] = buff[i++];
+  }
+}
+
+
+/*
+** Sort t[1..n] in place with the primitive '<', if all these elements
+** are in the array part of 't' and are all strings or all numbers;
+** otherwise, return 0. Primitive values have no '__lt' metamethods, so
+** the order is the one 'table.sort' would use. Only equal integers are
+** indistinguishable, so other kinds use merge sort when 'stable' is
+** true.
+*/
+
+/// @brief t[1..n]都在数组部分并且全是字符串或全是数字时,直接在数组上排序(stable为真时保持相等元素的顺序);否则返回0
+/// @param L 
+/// @param t 
+/// @param n 
+/// @param stable 
+/// @return 
+int luaV_sortarray (lua_State *L, Table *t, lua_Integer n, int stable) {
+  unsigned int un;
+  int kind;
+  if (n < 1 || n > cast(lua_Integer, luaH_realasize(t)))
+    return 0;
+  un = cast_uint(n);
+  kind = sortkind(t->array, un);
+  if (kind < 0)
+    return 0;  /* let the generic sort handle it */
+  luaH_checkwrite(L, t);
+  if (un <= SORTCUTOFF)
+    insertsort(t->array, un, kind);
+  else if (!stable || kind == SORTINT) {
+    int depth = 0;
+    unsigned int m;
+    for (m = un; m > 0; m >>= 1) depth += 2;  /* 2 * log2(n) */
+    introsort(t->array, un, kind, depth);
+  }
+  else {
+    /* no collection can run while the array is being sorted */
+    TValue *buff = luaM_newvector(L, un / 2, TValue);
+    mergesort(t->array, un, buff, kind);
+    luaM_freearray(L, buff, un / 2);
+  }
+  return 1;
+}
+
+/* }================================================================== */
+
+
 /*
 ** Main operation 'ra = #rb'.
 */
@@ -723,6 +1264,13 @@ void luaV_objlen (lua_State *L, StkId ra, const TValue *rb) {
       setivalue(s2v(ra), tsvalue(rb)->u.lnglen);//直接返回长度
       return;
     }
+    case LUA_VUSERDATA: {
+      if (uvalue(rb)->atype != 0) {  /* typed array? *///类型化数组,直接返回元素个数
+        setivalue(s2v(ra), luaV_arraylen(uvalue(rb)));
+        return;
+      }
+      /* else try metamethod */
+    }  /* FALLTHROUGH */
     default: {  /* try metamethod */
       tm = luaT_gettmbyobj(L, rb, TM_LEN);//获取元表
       if (l_unlikely(notm(tm)))  /* no metamethod? *///没有元表就报错
@@ -842,7 +1390,7 @@ void luaV_finishOp (lua_State *L) {
   CallInfo *ci = L->ci;
   StkId base = ci->func + 1;
   Instruction inst = *(ci->u.l.savedpc - 1);  /* interrupted instruction */
-  OpCode op = GET_OPCODE(inst);
+  OpCode op = GET_BASEOPCODE(inst);
   switch (op) {  /* finish its execution */
     case OP_MMBIN: case OP_MMBINI: case OP_MMBINK: {
       setobjs2s(L, base + GETARG_A(*(ci->u.l.savedpc - 2)), --L->top);
@@ -925,6 +1473,38 @@ void luaV_finishOp (lua_State *L) {
 #define l_gei(a,b)	(a >= b)
 
 
+/*
+** Quickening: the generic arithmetic and order instructions with two
+** register operands rewrite themselves in place into type-specialized
+** internal variants (OP_ADDII, OP_LTFF, etc.) after seeing two integer
+** or two float operands. A specialized instruction that meets other
+** operands rewrites itself back into the generic one; after MAXDEOPT
+** of these round trips (counted in the instruction's 'icache' entry)
+** the instruction stays generic. Define LUA_USE_QUICKEN as 0 to keep
+** all instructions generic.
+*/
+#if !defined(LUA_USE_QUICKEN) //是否使用指令特化
+#define LUA_USE_QUICKEN	1
+#endif
+
+/* maximum number of deoptimizations of an instruction */
+//一条指令最多被还原的次数,超过以后就不再特化
+#define MAXDEOPT	8
+
+//把当前指令改写成指令o
+#define setcurrentop(o)	SET_OPCODE(*cast(Instruction *, pc - 1), o)
+
+#if LUA_USE_QUICKEN
+//把当前指令特化成指令o
+#define quicken(o)	{ if (*ICACHE() < MAXDEOPT) setcurrentop(o); }
+#else
+#define quicken(o)	((void)0)
+#endif
+
+//把当前特化指令还原成通用指令o
+#define deoptimize(o)	{ setcurrentop(o); (*ICACHE())++; }
+
+
 /*
 ** Arithmetic operations with immediate operands. 'iop' is the integer
 ** operation, 'fop' is the float operation.
@@ -992,6 +1572,85 @@ void luaV_finishOp (lua_State *L) {
   op_arith_aux(L, v1, v2, iop, fop); }
 
 
+/*
+** Arithmetic operations with register operands whose fast tracks
+** quicken the instruction into 'qi' (integers) or 'qf' (floats).
+*/
+#define op_arithQ(L,iop,fop,qi,qf) {  \
+  TValue *v1 = vRB(i);  \
+  TValue *v2 = vRC(i);  \
+  if (ttisinteger(v1) && ttisinteger(v2)) {  \
+    lua_Integer i1 = ivalue(v1); lua_Integer i2 = ivalue(v2);  \
+    quicken(qi); pc++; setivalue(s2v(ra), iop(L, i1, i2));  \
+  }  \
+  else if (ttisfloat(v1) && ttisfloat(v2)) {  \
+    lua_Number n1 = fltvalue(v1); lua_Number n2 = fltvalue(v2);  \
+    quicken(qf); pc++; setfltvalue(s2v(ra), fop(L, n1, n2));  \
+  }  \
+  else op_arithf_aux(L, v1, v2, fop); }
+
+
+/*
+** Float arithmetic operations with register operands whose fast track
+** quickens the instruction into 'qf'.
+*/
+#define op_arithfQ(L,fop,qf) {  \
+  TValue *v1 = vRB(i);  \
+  TValue *v2 = vRC(i);  \
+  if (ttisfloat(v1) && ttisfloat(v2)) {  \
+    lua_Number n1 = fltvalue(v1); lua_Number n2 = fltvalue(v2);  \
+    quicken(qf); pc++; setfltvalue(s2v(ra), fop(L, n1, n2));  \
+  }  \
+  else op_arithf_aux(L, v1, v2, fop); }
+
+
+/*
+** Arithmetic operations specialized for two integers; other operands
+** turn the instruction back into 'op'.
+*/
+#define op_arithII(L,iop,fop,op) {  \
+  TValue *v1 = vRB(i);  \
+  TValue *v2 = vRC(i);  \
+  if (l_likely(ttisinteger(v1) && ttisinteger(v2))) {  \
+    lua_Integer i1 = ivalue(v1); lua_Integer i2 = ivalue(v2);  \
+    pc++; setivalue(s2v(ra), iop(L, i1, i2));  \
+  }  \
+  else {  \
+    deoptimize(op);  \
+    op_arithf_aux(L, v1, v2, fop);  \
+  }}
+
+
+/*
+** Arithmetic operations specialized for two floats; other operands
+** turn the instruction back into 'op'. ('op_arithfFF' is the version
+** for operations that always work with floats.)
+*/
+#define op_arithFF(L,iop,fop,op) {  \
+  TValue *v1 = vRB(i);  \
+  TValue *v2 = vRC(i);  \
+  if (l_likely(ttisfloat(v1) && ttisfloat(v2))) {  \
+    lua_Number n1 = fltvalue(v1); lua_Number n2 = fltvalue(v2);  \
+    pc++; setfltvalue(s2v(ra), fop(L, n1, n2));  \
+  }  \
+  else {  \
+    deoptimize(op);  \
+    op_arith_aux(L, v1, v2, iop, fop);  \
+  }}
+
+#define op_arithfFF(L,fop,op) {  \
+  TValue *v1 = vRB(i);  \
+  TValue *v2 = vRC(i);  \
+  if (l_likely(ttisfloat(v1) && ttisfloat(v2))) {  \
+    lua_Number n1 = fltvalue(v1); lua_Number n2 = fltvalue(v2);  \
+    pc++; setfltvalue(s2v(ra), fop(L, n1, n2));  \
+  }  \
+  else {  \
+    deoptimize(op);  \
+    op_arithf_aux(L, v1, v2, fop);  \
+  }}
+
+
 /*
 ** Arithmetic operations with K operands.
 */
@@ -1026,23 +1685,64 @@ void luaV_finishOp (lua_State *L) {
   }}
 
 
+/*
+** Auxiliary macro for order operations with register operands, for
+** the cases that are not handled by a fast track.
+*/
+#define op_order_aux(L,opn,other) {  \
+        if (ttisnumber(s2v(ra)) && ttisnumber(rb))  \
+          cond = opn(s2v(ra), rb);  \
+        else  \
+          Protect(cond = other(L, s2v(ra), rb)); }
+
+
 /*
 ** Order operations with register operands. 'opn' actually works
-** for all numbers, but the fast track improves performance for
-** integers.
+** for all numbers, but the fast tracks improve performance for
+** integers and floats. Those tracks also quicken the instruction
+** into 'qi' or 'qf'.
 */
-#define op_order(L,opi,opn,other) {  \
+#define op_order(L,opi,opf,opn,other,qi,qf) {  \
         int cond;  \
         TValue *rb = vRB(i);  \
         if (ttisinteger(s2v(ra)) && ttisinteger(rb)) {  \
           lua_Integer ia = ivalue(s2v(ra));  \
           lua_Integer ib = ivalue(rb);  \
-          cond = opi(ia, ib);  \
+          quicken(qi); cond = opi(ia, ib);  \
+        }  \
+        else if (ttisfloat(s2v(ra)) && ttisfloat(rb)) {  \
+          lua_Number na = fltvalue(s2v(ra));  \
+          lua_Number nb = fltvalue(rb);  \
+          quicken(qf); cond = opf(na, nb);  \
+        }  \
+        else op_order_aux(L, opn, other);  \
+        docondjump(); }
+
+
+/*
+** Order operations specialized for integers ('opi') or floats
+** ('opf'); other operands turn the instruction back into 'op'.
+*/
+#define op_orderII(L,opi,opn,other,op) {  \
+        int cond;  \
+        TValue *rb = vRB(i);  \
+        if (l_likely(ttisinteger(s2v(ra)) && ttisinteger(rb)))  \
+          cond = opi(ivalue(s2v(ra)), ivalue(rb));  \
+        else {  \
+          deoptimize(op);  \
+          op_order_aux(L, opn, other);  \
+        }  \
+        docondjump(); }
+
+#define op_orderFF(L,opf,opn,other,op) {  \
+        int cond;  \
+        TValue *rb = vRB(i);  \
+        if (l_likely(ttisfloat(s2v(ra)) && ttisfloat(rb)))  \
+          cond = opf(fltvalue(s2v(ra)), fltvalue(rb));  \
+        else {  \
+          deoptimize(op);  \
+          op_order_aux(L, opn, other);  \
         }  \
-        else if (ttisnumber(s2v(ra)) && ttisnumber(rb))  \
-          cond = opn(s2v(ra), rb);  \
-        else  \
-          Protect(cond = other(L, s2v(ra), rb));  \
         docondjump(); }
 
 
@@ -1066,6 +1766,33 @@ void luaV_finishOp (lua_State *L) {
         }  \
         docondjump(); }
 
+
+/*
+** Bodies of instructions that can also be the first half of a
+** superinstruction.
+*/
+#define op_gettabup(L) {  \
+  const TValue *slot;  \
+  TValue *upval = cl->upvals[GETARG_B(i)]->v;  \
+  TValue *rc = KC(i);  \
+  TString *key = tsvalue(rc);  /* key must be a string */  \
+  if (luaV_fastgetic(L, upval, key, ICACHE(), slot)) {  \
+    setobj2s(L, ra, slot);  \
+  }  \
+  else  \
+    Protect(luaV_finishget(L, upval, rc, ra, slot)); }
+
+#define op_getfield(L) {  \
+  const TValue *slot;  \
+  TValue *rb = vRB(i);  \
+  TValue *rc = KC(i);  \
+  TString *key = tsvalue(rc);  /* key must be a string */  \
+  if (luaV_fastgetic(L, rb, key, ICACHE(), slot)) {  \
+    setobj2s(L, ra, slot);  \
+  }  \
+  else  \
+    Protect(luaV_finishget(L, rb, rc, ra, slot)); }
+
 /* }================================================================== */
 
 
@@ -1094,6 +1821,10 @@ void luaV_finishOp (lua_State *L) {
 #define KC(i)	(k+GETARG_C(i))//获取寄存器C上的常量
 #define RKC(i)	((TESTARG_k(i)) ? k + GETARG_C(i) : s2v(base + GETARG_C(i)))//如果i是常量池索引,那么就返回C寄存器上的常量,反之返回C寄存器上的值
 
+/* inline cache of the instruction being executed */
+//当前执行指令的内联缓存
+#define ICACHE()	(cl->p->icache + pcRel(pc, cl->p))
+
 
 //设置信号中断开关
 #define updatetrap(ci)  (trap = ci->u.l.trap)
@@ -1166,6 +1897,17 @@ void luaV_finishOp (lua_State *L) {
 ///保护只能引发错误的代码
 #define halfProtect(exp)  (savestate(L,ci), (exp))
 
+/*
+** 'luaV_finishfastset' for the interpreter: a frozen table raises an
+** error from the check, which then needs the saved state.
+*/
+#define finishfastset(t,slot,v) \
+  { if (l_unlikely(ischainmember(hvalue(t)))) \
+      halfProtect(luaH_writeguard(L, hvalue(t))); \
+    setobj2t(L, cast(TValue *,slot), v); \
+    luaC_barrierback(L, gcvalue(t), v); }
+
+
 /* 'c' is the limit of live values in the stack */
 //检测GC,条件满足自动触发gc
 #define checkGC(L,c)  \
@@ -1190,6 +1932,19 @@ void luaV_finishOp (lua_State *L) {
   ra = RA(i); /* WARNING: any stack reallocation invalidates 'ra' */ \
 }
 
+/*
+** Second half of a superinstruction (see 'luaK_finish'): unless there
+** are hooks or the stack was reallocated (which need 'vmfetch'), run
+** the next instruction directly at label 'l'.
+*/
+#define vmfuse(l)	{ \
+  if (l_likely(!trap)) { \
+    i = *(pc++); \
+    ra = RA(i); \
+    goto l; \
+  } \
+}
+
 #define vmdispatch(o)	switch(o) //switch 
 #define vmcase(l)	case l: //case 
 #define vmbreak		break //break
@@ -1243,7 +1998,8 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
     /* invalidate top for instructions not expecting it *///不合规的指令直接抛弃掉
     lua_assert(isIT(i) || (cast_void(L->top = base), 1));
     vmdispatch (GET_OPCODE(i)) {//Switch(指令)
-      vmcase(OP_MOVE) {//将B寄存器的值赋值给A寄存器
+      vmcase(OP_MOVE)
+      l_move: {//将B寄存器的值赋值给A寄存器
         setobjs2s(L, ra, RB(i));
         vmbreak;
       }
@@ -1300,15 +2056,7 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         vmbreak;
       }
       vmcase(OP_GETTABUP) {//从表取值到寄存器,标在upvalue
-        const TValue *slot;
-        TValue *upval = cl->upvals[GETARG_B(i)]->v;
-        TValue *rc = KC(i);
-        TString *key = tsvalue(rc);  /* key must be a string */
-        if (luaV_fastget(L, upval, key, slot, luaH_getshortstr)) {
-          setobj2s(L, ra, slot);
-        }
-        else
-          Protect(luaV_finishget(L, upval, rc, ra, slot));
+        op_gettabup(L);
         vmbreak;
       }
       vmcase(OP_GETTABLE) {//从表取值到寄存器
@@ -1321,7 +2069,8 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
             : luaV_fastget(L, rb, rc, slot, luaH_get)) {
           setobj2s(L, ra, slot);
         }
-        else
+        else if (!ttisinteger(rc) ||  /* not an element of a typed array? */
+                 !fastgetarray(rb, ivalue(rc), s2v(ra)))
           Protect(luaV_finishget(L, rb, rc, ra, slot));
         vmbreak;
       }
@@ -1332,23 +2081,16 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         if (luaV_fastgeti(L, rb, c, slot)) {
           setobj2s(L, ra, slot);
         }
-        else {
+        else if (!fastgetarray(rb, c, s2v(ra))) {  /* not a typed array? */
           TValue key;
           setivalue(&key, c);
           Protect(luaV_finishget(L, rb, &key, ra, slot));
         }
         vmbreak;
       }
-      vmcase(OP_GETFIELD) {//从表取字符串字段值给寄存器
-        const TValue *slot;
-        TValue *rb = vRB(i);
-        TValue *rc = KC(i);
-        TString *key = tsvalue(rc);  /* key must be a string */
-        if (luaV_fastget(L, rb, key, slot, luaH_getshortstr)) {
-          setobj2s(L, ra, slot);
-        }
-        else
-          Protect(luaV_finishget(L, rb, rc, ra, slot));
+      vmcase(OP_GETFIELD)
+      l_getfield: {//从表取字符串字段值给寄存器
+        op_getfield(L);
         vmbreak;
       }
       vmcase(OP_SETTABUP) {//设置寄存器值给表元素,表在upvalue
@@ -1357,8 +2099,8 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         TValue *rb = KB(i);
         TValue *rc = RKC(i);
         TString *key = tsvalue(rb);  /* key must be a string */
-        if (luaV_fastget(L, upval, key, slot, luaH_getshortstr)) {
-          luaV_finishfastset(L, upval, slot, rc);
+        if (luaV_fastgetic(L, upval, key, ICACHE(), slot)) {
+          finishfastset(upval, slot, rc);
         }
         else
           Protect(luaV_finishset(L, upval, rb, rc, slot));
@@ -1372,9 +2114,10 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         if (ttisinteger(rb)  /* fast track for integers? */
             ? (cast_void(n = ivalue(rb)), luaV_fastgeti(L, s2v(ra), n, slot))
             : luaV_fastget(L, s2v(ra), rb, slot, luaH_get)) {
-          luaV_finishfastset(L, s2v(ra), slot, rc);
+          finishfastset(s2v(ra), slot, rc);
         }
-        else
+        else if (!ttisinteger(rb) ||  /* not an element of a typed array? */
+                 !fastsetarray(s2v(ra), ivalue(rb), rc))
           Protect(luaV_finishset(L, s2v(ra), rb, rc, slot));
         vmbreak;
       }
@@ -1383,9 +2126,9 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         int c = GETARG_B(i);
         TValue *rc = RKC(i);
         if (luaV_fastgeti(L, s2v(ra), c, slot)) {
-          luaV_finishfastset(L, s2v(ra), slot, rc);
+          finishfastset(s2v(ra), slot, rc);
         }
-        else {
+        else if (!fastsetarray(s2v(ra), c, rc)) {  /* not a typed array? */
           TValue key;
           setivalue(&key, c);
           Protect(luaV_finishset(L, s2v(ra), &key, rc, slot));
@@ -1397,8 +2140,8 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         TValue *rb = KB(i);
         TValue *rc = RKC(i);
         TString *key = tsvalue(rb);  /* key must be a string */
-        if (luaV_fastget(L, s2v(ra), key, slot, luaH_getshortstr)) {
-          luaV_finishfastset(L, s2v(ra), slot, rc);
+        if (luaV_fastgetic(L, s2v(ra), key, ICACHE(), slot)) {
+          finishfastset(s2v(ra), slot, rc);
         }
         else
           Protect(luaV_finishset(L, s2v(ra), rb, rc, slot));
@@ -1417,18 +2160,34 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         L->top = ra + 1;  /* correct top in case of emergency GC */
         t = luaH_new(L);  /* memory allocation */
         sethvalue2s(L, ra, t);
+        b = luaH_hashhint(b);  /* small records will use shapes */
         if (b != 0 || c != 0)
           luaH_resize(L, t, c, b);  /* idem */
         checkGC(L, ra + 1);
         vmbreak;
       }
+      vmcase(OP_NEWTEMPLATE) {//用表构造模板新建一个表
+        const TableTemplate *tp = &cl->p->templates[*ICACHE()];
+        Table *t;
+        pc++;  /* skip extra argument */
+        L->top = ra + 1;  /* correct top in case of emergency GC */
+        t = luaH_new(L);  /* memory allocation */
+        sethvalue2s(L, ra, t);
+        luaH_setshape(L, t, tp->shape, tp->values);  /* idem */
+        if (l_likely(!trap))  /* hooks see every store */
+          pc += tp->skip;  /* skip stores of constant fields */
+        checkGC(L, ra + 1);
+        vmbreak;
+      }
       vmcase(OP_SELF) {//准备一个对象方法的调用
         const TValue *slot;
         TValue *rb = vRB(i);
         TValue *rc = RKC(i);
         TString *key = tsvalue(rc);  /* key must be a string */
         setobj2s(L, ra + 1, rb);
-        if (luaV_fastget(L, rb, key, slot, luaH_getstr)) {
+        if (ttisshrstring(rc)  /* cacheable key? */
+            ? luaV_fastgetic(L, rb, key, ICACHE(), slot)
+            : luaV_fastget(L, rb, key, slot, luaH_getstr)) {
           setobj2s(L, ra, slot);
         }
         else
@@ -1498,15 +2257,15 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         vmbreak;
       }
       vmcase(OP_ADD) {//加
-        op_arith(L, l_addi, luai_numadd);
+        op_arithQ(L, l_addi, luai_numadd, OP_ADDII, OP_ADDFF);
         vmbreak;
       }
       vmcase(OP_SUB) {//减
-        op_arith(L, l_subi, luai_numsub);
+        op_arithQ(L, l_subi, luai_numsub, OP_SUBII, OP_SUBFF);
         vmbreak;
       }
       vmcase(OP_MUL) {//乘
-        op_arith(L, l_muli, luai_nummul);
+        op_arithQ(L, l_muli, luai_nummul, OP_MULII, OP_MULFF);
         vmbreak;
       }
       vmcase(OP_MOD) {//模
@@ -1518,7 +2277,7 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         vmbreak;
       }
       vmcase(OP_DIV) {  /* float division (always with floats) *///浮点除
-        op_arithf(L, luai_numdiv);
+        op_arithfQ(L, luai_numdiv, OP_DIVFF);
         vmbreak;
       }
       vmcase(OP_IDIV) {  /* floor division *///整除
@@ -1550,7 +2309,8 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         TValue *rb = vRB(i);
         TMS tm = (TMS)GETARG_C(i);
         StkId result = RA(pi);
-        lua_assert(OP_ADD <= GET_OPCODE(pi) && GET_OPCODE(pi) <= OP_SHR);
+        lua_assert(OP_ADD <= GET_BASEOPCODE(pi) &&
+                   GET_BASEOPCODE(pi) <= OP_SHR);
         Protect(luaT_trybinTM(L, s2v(ra), rb, result, tm));
         vmbreak;
       }
@@ -1636,11 +2396,13 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         vmbreak;
       }
       vmcase(OP_LT) {//小于等于测试,条件跳转
-        op_order(L, l_lti, LTnum, lessthanothers);
+        op_order(L, l_lti, luai_numlt, LTnum, lessthanothers,
+                    OP_LTII, OP_LTFF);
         vmbreak;
       }
       vmcase(OP_LE) {//小于等于测试,条件跳转
-        op_order(L, l_lei, LEnum, lessequalothers);
+        op_order(L, l_lei, luai_numle, LEnum, lessequalothers,
+                    OP_LEII, OP_LEFF);
         vmbreak;
       }
       vmcase(OP_EQK) {//常量相等测试,条件跳转
@@ -1693,7 +2455,8 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         }
         vmbreak;
       }
-      vmcase(OP_CALL) {//函数调用 
+      vmcase(OP_CALL)
+      l_call: {//函数调用 
         CallInfo *newci;
         int b = GETARG_B(i);
         int nresults = GETARG_C(i) - 1;
@@ -1850,6 +2613,30 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
            to-be-closed variable. The call will use the stack after
            these values (starting at 'ra + 4')
         */
+        if (ttislcf(s2v(ra)) && fvalue(s2v(ra)) == G(L)->nextf &&
+            ttistable(s2v(ra + 1)) && !L->hookmask &&
+            L->tbclist != ra + 3 &&  /* no to-be-closed value there? */
+            (ttisnil(s2v(ra + 3)) || ttisinteger(s2v(ra + 3)))) {
+          /* 'next' over a table: traverse it in place, keeping in 'ra + 3'
+             (which was nil at OP_TFORPREP, as 'tbclist' does not point to
+             it) the position of the control variable, so that it needs
+             not be searched again */
+          unsigned int pos = ttisinteger(s2v(ra + 3))
+                           ? cast_uint(ivalue(s2v(ra + 3))) : 0;
+          int n;
+          setobjs2s(L, ra + 4, ra + 2);
+          halfProtect(pos = luaH_nextpos(L, hvalue(s2v(ra + 1)), ra + 4, pos));
+          if (pos == 0)  /* no more elements? */
+            setnilvalue(s2v(ra + 4));
+          else {
+            setivalue(s2v(ra + 3), pos);
+            for (n = GETARG_C(i); n > 2; n--)  /* extra variables get nil */
+              setnilvalue(s2v(ra + 3 + n));
+          }
+          i = *(pc++);  /* go to next instruction */
+          lua_assert(GET_OPCODE(i) == OP_TFORLOOP && ra == RA(i));
+          goto l_tforloop;
+        }
         /* push function, state, and control variable */
         memcpy(ra + 4, ra, 3 * sizeof(*ra));
         L->top = ra + 4 + 3;
@@ -1914,6 +2701,75 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         lua_assert(0);
         vmbreak;
       }
+      vmcase(OP_GETTABUPFIELD) {//GETTABUP后紧跟GETFIELD
+        op_gettabup(L);
+        vmfuse(l_getfield);
+        vmbreak;
+      }
+      vmcase(OP_GETFIELDFIELD) {//GETFIELD后紧跟GETFIELD
+        op_getfield(L);
+        vmfuse(l_getfield);
+        vmbreak;
+      }
+      vmcase(OP_GETFIELDCALL) {//GETFIELD后紧跟CALL
+        op_getfield(L);
+        vmfuse(l_call);
+        vmbreak;
+      }
+      vmcase(OP_MOVEMOVE) {//MOVE后紧跟MOVE
+        setobjs2s(L, ra, RB(i));
+        vmfuse(l_move);
+        vmbreak;
+      }
+      vmcase(OP_MOVECALL) {//MOVE后紧跟CALL
+        setobjs2s(L, ra, RB(i));
+        vmfuse(l_call);
+        vmbreak;
+      }
+      vmcase(OP_ADDII) {//整数加
+        op_arithII(L, l_addi, luai_numadd, OP_ADD);
+        vmbreak;
+      }
+      vmcase(OP_ADDFF) {//浮点加
+        op_arithFF(L, l_addi, luai_numadd, OP_ADD);
+        vmbreak;
+      }
+      vmcase(OP_SUBII) {//整数减
+        op_arithII(L, l_subi, luai_numsub, OP_SUB);
+        vmbreak;
+      }
+      vmcase(OP_SUBFF) {//浮点减
+        op_arithFF(L, l_subi, luai_numsub, OP_SUB);
+        vmbreak;
+      }
+      vmcase(OP_MULII) {//整数乘
+        op_arithII(L, l_muli, luai_nummul, OP_MUL);
+        vmbreak;
+      }
+      vmcase(OP_MULFF) {//浮点乘
+        op_arithFF(L, l_muli, luai_nummul, OP_MUL);
+        vmbreak;
+      }
+      vmcase(OP_DIVFF) {//浮点除
+        op_arithfFF(L, luai_numdiv, OP_DIV);
+        vmbreak;
+      }
+      vmcase(OP_LTII) {//整数小于测试
+        op_orderII(L, l_lti, LTnum, lessthanothers, OP_LT);
+        vmbreak;
+      }
+      vmcase(OP_LTFF) {//浮点小于测试
+        op_orderFF(L, luai_numlt, LTnum, lessthanothers, OP_LT);
+        vmbreak;
+      }
+      vmcase(OP_LEII) {//整数小于等于测试
+        op_orderII(L, l_lei, LEnum, lessequalothers, OP_LE);
+        vmbreak;
+      }
+      vmcase(OP_LEFF) {//浮点小于等于测试
+        op_orderFF(L, luai_numle, LEnum, lessequalothers, OP_LE);
+        vmbreak;
+      }
     }
   }
 }
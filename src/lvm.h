@@ -108,17 +108,37 @@ typedef enum {
       !isempty(slot)))  /* result not empty? */
 
 
+/*
+** Variant of 'luaV_fastget' for short-string keys at instructions with
+** an inline cache 'ic' (see 'luaH_probeshortstr').
+*/
+#define luaV_fastgetic(L,t,k,ic,slot) \
+  (!ttistable(t)  \
+   ? (slot = NULL, 0)  /* not a table; 'slot' is NULL and result is 0 */  \
+   : (slot = luaH_probeshortstr(hvalue(t), k, ic),  /* cached access */  \
+      !isempty(slot)))  /* result not empty? */
+
+
+/* number of elements of typed array 'u' */
+#define luaV_arraylen(u)	((u)->len >> luaV_arraylsize[(u)->atype])
+
+
 /*
 ** Finish a fast set operation (when fast get succeeds). In that case,
-** 'slot' points to the place to put the value.
+** 'slot' points to the place to put the value. (The table is checked
+** first, as it may be frozen.)
 */
 #define luaV_finishfastset(L,t,slot,v) \
-    { setobj2t(L, cast(TValue *,slot), v); \
+    { luaH_checkwrite(L, hvalue(t)); \
+      setobj2t(L, cast(TValue *,slot), v); \
       luaC_barrierback(L, gcvalue(t), v); }
 
 
 
 
+LUAI_DDEC(const lu_byte luaV_arraylsize[LUA_NUMATYPES + 1];)
+
+
 LUAI_FUNC int luaV_equalobj (lua_State *L, const TValue *t1, const TValue *t2);
 LUAI_FUNC int luaV_lessthan (lua_State *L, const TValue *l, const TValue *r);
 LUAI_FUNC int luaV_lessequal (lua_State *L, const TValue *l, const TValue *r);
@@ -131,9 +151,15 @@ LUAI_FUNC void luaV_finishget (lua_State *L, const TValue *t, TValue *key,
                                StkId val, const TValue *slot);
 LUAI_FUNC void luaV_finishset (lua_State *L, const TValue *t, TValue *key,
                                TValue *val, const TValue *slot);
+LUAI_FUNC int luaV_arrayget (Udata *u, lua_Integer k, TValue *res);
+LUAI_FUNC int luaV_arrayset (Udata *u, lua_Integer k, const TValue *v);
 LUAI_FUNC void luaV_finishOp (lua_State *L);
 LUAI_FUNC void luaV_execute (lua_State *L, CallInfo *ci);
 LUAI_FUNC void luaV_concat (lua_State *L, int total);
+LUAI_FUNC TString *luaV_concattable (lua_State *L, Table *t, lua_Integer i,
+                        lua_Integer j, const char *sep, size_t lsep);
+LUAI_FUNC int luaV_sortarray (lua_State *L, Table *t, lua_Integer n,
+                            int stable);
 LUAI_FUNC lua_Integer luaV_idiv (lua_State *L, lua_Integer x, lua_Integer y);
 LUAI_FUNC lua_Integer luaV_mod (lua_State *L, lua_Integer x, lua_Integer y);
 LUAI_FUNC lua_Number luaV_modf (lua_State *L, lua_Number x, lua_Number y);